@@ -7,6 +7,10 @@
 #include <sstream>
 #include <math.h>
 #include <unordered_map>
+#include <thread>
+#include <atomic>
+#include <mutex>
+#include <numeric>
 #include "tools.hh"
 #include "custom_talib_wrapper.hh"
 #include <ta-lib/ta_libc.h>
@@ -61,6 +65,8 @@ const uint MIN_NUMBER_OF_TRADES = 1000;        // minimum number of trades requi
 const float MIN_ALLOWED_MAX_DRAWBACK = -50.0f; // %
 vector<float> range_STOCH_RSI_LOWER = {0.1f, 0.2f, 0.3f, 0.4f, 0.5f, 0.6f, 0.7f, 0.8f, 0.9f};
 uint start_indexes[NB_PAIRS];
+TIME_AXIS AXIS;          // shared timeline of PAIRS (see align_pairs)
+CALENDAR_INDEX CALENDAR; // calendar of AXIS
 
 // RANGE OF PARAMETERS TO TEST
 // const int range_step = 2;
@@ -71,14 +77,14 @@ vector<int> range_EMA3 = integer_range(25, 350, 10);
 vector<float> range_UP{3.0, 4.0, 5.0, 6.0, 7.0, 8.0, 9.0, 10.0, 11.0, 12.0};
 vector<float> range_DOWN{3.0, 4.0, 5.0, 6.0, 7.0, 8.0, 9.0, 10.0, 11.0, 12.0};
 //////////////////////////
-array<std::unordered_map<string, vector<float>>, NB_PAIRS> INDICATORS{};
+array<INDICATOR_REGISTRY, NB_PAIRS> INDICATORS{}; // shared by the NB_THREADS workers
+const size_t INDICATOR_CACHE_BYTES = size_t(8) << 30; // for all pairs; 0 keeps every indicator computed
+const COLUMN_ENCODING INDICATOR_ENCODING = ENC_FLOAT32; // ENC_FP16, ENC_BF16 or ENC_INT16 keep the %D columns on 2 bytes per bar
 
-array<long int, NB_PAIRS> last_times{};
-
-uint i_print = 0;
-uint nb_tested = 0;
+std::atomic<uint> nb_tested{0};
 
 RUN_RESULTf best{};
+std::mutex BEST_MUTEX; // guards best, the progress printing and best_params.txt
 
 uint end_timestamp_datasets = 0;
 
@@ -180,61 +186,35 @@ void print_best_res(const RUN_RESULTf &bestt)
 
 //////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
-bool key_exists(const std::unordered_map<string, vector<float>> &m, const string &ch)
-{
-    if (m.find(ch) != m.end())
-    {
-        return true;
-    }
-    else
-    {
-        return false;
-    }
-}
-
-//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
-
 RUN_RESULTf PROCESS(const vector<KLINEf> &PAIRS, const int ema1, const int ema2, int ema3, const float up, const float down, const float STOCH_RSI_LOWER, const uint MAX_OPEN_TRADES)
 {
-    nb_tested++;
+    const uint nb_done = ++nb_tested;
 
-    for (int ic = 0; ic < NB_PAIRS; ic++)
+    // indicators are computed on first use and pinned in INDICATORS for the run, then only their spans are read in the bar loop
+    const uint NB_IND = 6;
+    array<array<uint, NB_IND>, NB_PAIRS> HANDLES;
+    array<const float *, NB_PAIRS> EMA1, EMA2, EMA3, STOCH_RSI_K, STOCH_RSI_D, ATR;
+    for (uint ic = 0; ic < NB_PAIRS; ic++)
     {
-        const string k1 = "EMA_" + std::to_string(ema1);
-        const string k2 = "EMA_" + std::to_string(ema2);
-        const string k3 = "EMA_" + std::to_string(ema3);
-        if (!key_exists(INDICATORS[ic], k1))
-        {
-            INDICATORS[ic][k1] = TALIB_EMA(PAIRS[ic].close, ema1);
-        }
-        if (!key_exists(INDICATORS[ic], k2))
-        {
-            INDICATORS[ic][k2] = TALIB_EMA(PAIRS[ic].close, ema2);
-        }
-        if (!key_exists(INDICATORS[ic], k3))
-        {
-            INDICATORS[ic][k3] = TALIB_EMA(PAIRS[ic].close, ema3);
-        }
-        if (!key_exists(INDICATORS[ic], "StochRSI_K"))
-        {
-            INDICATORS[ic]["StochRSI_K"] = TALIB_STOCHRSI_K(PAIRS[ic].close, 14, 14, 3, 3);
-        }
-        if (!key_exists(INDICATORS[ic], "StochRSI_D"))
-        {
-            INDICATORS[ic]["StochRSI_D"] = TALIB_STOCHRSI_D(PAIRS[ic].close, 14, 14, 3, 3);
-        }
-        if (!key_exists(INDICATORS[ic], "ATR"))
+        const INDICATOR_SPEC specs[NB_IND] = {{IND_EMA, ema1}, {IND_EMA, ema2}, {IND_EMA, ema3}, {IND_STOCHRSI_K, 14, 14, 3, 3}, {IND_STOCHRSI_D, 14, 14, 3, 3}, {IND_ATR, 14}};
+        for (uint k = 0; k < NB_IND; k++)
         {
-            INDICATORS[ic]["ATR"] = TALIB_ATR(PAIRS[ic].high, PAIRS[ic].low, PAIRS[ic].close, 14);
+            HANDLES[ic][k] = INDICATORS[ic].acquire(PAIRS[ic], specs[k]);
         }
+        EMA1[ic] = INDICATORS[ic].span(HANDLES[ic][0]);
+        EMA2[ic] = INDICATORS[ic].span(HANDLES[ic][1]);
+        EMA3[ic] = INDICATORS[ic].span(HANDLES[ic][2]);
+        STOCH_RSI_K[ic] = INDICATORS[ic].span(HANDLES[ic][3]);
+        STOCH_RSI_D[ic] = INDICATORS[ic].span(HANDLES[ic][4]);
+        ATR[ic] = INDICATORS[ic].span(HANDLES[ic][5]);
     }
 
     RUN_RESULTf result{};
 
     vector<float> USDT_tracking{};
-    vector<int> USDT_tracking_ts{};
+    vector<uint> USDT_tracking_bars{};
 
-    const uint nb_max = PAIRS[0].nb;
+    const uint nb_max = AXIS.nb;
 
     bool LAST_ITERATION = false;
     uint nb_profit = 0;
@@ -255,7 +235,7 @@ RUN_RESULTf PROCESS(const vector<KLINEf> &PAIRS, const int ema1, const int ema2,
 
     uint ACTIVE_POSITIONS = 0;
 
-    const uint ii_begin = start_indexes[0];
+    const uint ii_begin = *std::min_element(start_indexes, start_indexes + NB_PAIRS);
 
     bool NEW_MONTH = false;
 
@@ -264,41 +244,32 @@ RUN_RESULTf PROCESS(const vector<KLINEf> &PAIRS, const int ema1, const int ema2,
         if (ii == nb_max - 1)
             LAST_ITERATION = true;
 
-        const int month_b = get_month_from_timestamp(PAIRS[0].timestamp[ii - 1]);
-        const int month = get_month_from_timestamp(PAIRS[0].timestamp[ii]);
-
-        if (month_b != month)
-        {
-            NEW_MONTH = true;
-        }
-        else
-        {
-            NEW_MONTH = false;
-        }
+        NEW_MONTH = (CALENDAR.flags[ii] & CAL_NEW_MONTH) != 0;
 
         bool closed = false;
         // For all pairs, check to close / open positions
         for (uint ic = 0; ic < NB_PAIRS; ic++)
         {
-            if (ii < start_indexes[ic])
+            if (ii < start_indexes[ic] || AXIS.is_gap(ic, ii))
                 continue;
+            const uint jj = AXIS.local(ic, ii); // bar ii of the axis in the pair's own data
 
             // conditions for open / close position
 
-            bool OPEN_LONG_CONDI = INDICATORS[ic]["EMA_" + std::to_string(ema1)][ii] >= INDICATORS[ic]["EMA_" + std::to_string(ema2)][ii] 
-                                    && INDICATORS[ic]["EMA_" + std::to_string(ema2)][ii] >= INDICATORS[ic]["EMA_" + std::to_string(ema3)][ii] 
-                                    && PAIRS[ic].close[ii] >= INDICATORS[ic]["EMA_" + std::to_string(ema1)][ii] 
-                                    && INDICATORS[ic]["StochRSI_K"][ii] < STOCH_RSI_LOWER 
-                                    && INDICATORS[ic]["StochRSI_D"][ii] < STOCH_RSI_LOWER 
-                                    && INDICATORS[ic]["StochRSI_K"][ii - 1] > INDICATORS[ic]["StochRSI_D"][ii - 1] 
-                                    && INDICATORS[ic]["StochRSI_K"][ii] <= INDICATORS[ic]["StochRSI_D"][ii];
+            bool OPEN_LONG_CONDI = EMA1[ic][jj] >= EMA2[ic][jj] 
+                                    && EMA2[ic][jj] >= EMA3[ic][jj] 
+                                    && PAIRS[ic].close[jj] >= EMA1[ic][jj] 
+                                    && STOCH_RSI_K[ic][jj] < STOCH_RSI_LOWER 
+                                    && STOCH_RSI_D[ic][jj] < STOCH_RSI_LOWER 
+                                    && STOCH_RSI_K[ic][jj - 1] > STOCH_RSI_D[ic][jj - 1] 
+                                    && STOCH_RSI_K[ic][jj] <= STOCH_RSI_D[ic][jj];
 
             bool timeout = false;
             bool hard_TP_condition = false;
             if (COIN_AMOUNTS[ic] != 0.0f)
             {
-                timeout = (PAIRS[ic].timestamp[ii] - OPEN_TS[ic]) >= 2 * 24 * 3600;
-                const float pc_gain = (PAIRS[ic].close[ii] - price_position_open[ic]) / price_position_open[ic] * 100.0f;
+                timeout = (PAIRS[ic].timestamp[jj] - OPEN_TS[ic]) >= 2 * 24 * 3600;
+                const float pc_gain = (PAIRS[ic].close[jj] - price_position_open[ic]) / price_position_open[ic] * 100.0f;
                 hard_TP_condition = pc_gain > 15.0f;
             }
             else
@@ -306,8 +277,8 @@ RUN_RESULTf PROCESS(const vector<KLINEf> &PAIRS, const int ema1, const int ema2,
                 timeout = false;
             }
 
-            bool CLOSE_LONG_CONDI = PAIRS[ic].close[ii] > price_position_open[ic] + up * ATR_AT_OPEN[ic] 
-                                    || PAIRS[ic].close[ii] < price_position_open[ic] - down * ATR_AT_OPEN[ic] 
+            bool CLOSE_LONG_CONDI = PAIRS[ic].close[jj] > price_position_open[ic] + up * ATR_AT_OPEN[ic] 
+                                    || PAIRS[ic].close[jj] < price_position_open[ic] - down * ATR_AT_OPEN[ic] 
                                     || timeout || hard_TP_condition;
 
             // IT IS IMPORTANT TO CHECK FIRST FOR CLOSING POSITION AND ONLY THEN FOR OPENING POSITION
@@ -315,7 +286,7 @@ RUN_RESULTf PROCESS(const vector<KLINEf> &PAIRS, const int ema1, const int ema2,
             // CLOSE LONG
             if (COIN_AMOUNTS[ic] > 0.0f && (CLOSE_LONG_CONDI || LAST_ITERATION))
             {
-                const float to_add = COIN_AMOUNTS[ic] * PAIRS[ic].close[ii];
+                const float to_add = COIN_AMOUNTS[ic] * PAIRS[ic].close[jj];
                 USDT_amount += to_add;
                 COIN_AMOUNTS[ic] = 0.0f;
                 ATR_AT_OPEN[ic] = 0.0f;
@@ -328,7 +299,7 @@ RUN_RESULTf PROCESS(const vector<KLINEf> &PAIRS, const int ema1, const int ema2,
                 USDT_amount -= fe;
                 total_fees_paid_USDT += fe;
                 //
-                if (PAIRS[ic].close[ii] >= price_position_open[ic])
+                if (PAIRS[ic].close[jj] >= price_position_open[ic])
                 {
                     nb_profit++;
                 }
@@ -342,19 +313,19 @@ RUN_RESULTf PROCESS(const vector<KLINEf> &PAIRS, const int ema1, const int ema2,
             // OPEN LONG
             if (COIN_AMOUNTS[ic] == 0.0f && OPEN_LONG_CONDI && LAST_ITERATION == false && ACTIVE_POSITIONS < MAX_OPEN_TRADES)
             {
-                price_position_open[ic] = PAIRS[ic].close[ii];
+                price_position_open[ic] = PAIRS[ic].close[jj];
 
                 const float usdMultiplier = 1.0f / float(MAX_OPEN_TRADES - ACTIVE_POSITIONS);
 
-                COIN_AMOUNTS[ic] = USDT_amount * usdMultiplier / PAIRS[ic].close[ii];
+                COIN_AMOUNTS[ic] = USDT_amount * usdMultiplier / PAIRS[ic].close[jj];
                 USDT_amount -= USDT_amount * usdMultiplier;
-                ATR_AT_OPEN[ic] = INDICATORS[ic]["ATR"][ii];
-                OPEN_TS[ic] = PAIRS[ic].timestamp[ii];
+                ATR_AT_OPEN[ic] = ATR[ic][jj];
+                OPEN_TS[ic] = PAIRS[ic].timestamp[jj];
 
                 // apply FEEs
                 const float fe = COIN_AMOUNTS[ic] * FEE / 100.0f;
                 COIN_AMOUNTS[ic] -= fe;
-                total_fees_paid_USDT += fe * PAIRS[ic].close[ii];
+                total_fees_paid_USDT += fe * PAIRS[ic].close[jj];
                 //
 
                 ACTIVE_POSITIONS++;
@@ -368,7 +339,7 @@ RUN_RESULTf PROCESS(const vector<KLINEf> &PAIRS, const int ema1, const int ema2,
             array<float, NB_PAIRS> closes{};
             for (uint ic = 0; ic < NB_PAIRS; ic++)
             {
-                closes[ic] = PAIRS[ic].close[ii];
+                closes[ic] = AXIS.listed(ic, ii) ? PAIRS[ic].close[AXIS.local(ic, ii)] : 0.0f;
             }
 
             WALLET_VAL_USDT = USDT_amount + vector_product(COIN_AMOUNTS, closes);
@@ -384,14 +355,22 @@ RUN_RESULTf PROCESS(const vector<KLINEf> &PAIRS, const int ema1, const int ema2,
             }
 
             USDT_tracking.push_back(WALLET_VAL_USDT);
-            USDT_tracking_ts.push_back(PAIRS[0].timestamp[ii]);
+            USDT_tracking_bars.push_back(ii);
+        }
+    }
+
+    for (uint ic = 0; ic < NB_PAIRS; ic++)
+    {
+        for (const uint handle : HANDLES[ic])
+        {
+            INDICATORS[ic].release(handle);
         }
     }
 
     array<float, NB_PAIRS> last_closes{};
     for (uint ic = 0; ic < NB_PAIRS; ic++)
     {
-        last_closes[ic] = PAIRS[ic].close[nb_max - 1];
+        last_closes[ic] = PAIRS[ic].close[PAIRS[ic].nb - 1];
     }
 
     WALLET_VAL_USDT = USDT_amount + vector_product(COIN_AMOUNTS, last_closes);
@@ -401,14 +380,13 @@ RUN_RESULTf PROCESS(const vector<KLINEf> &PAIRS, const int ema1, const int ema2,
     const float DDC = (1.0f / (1.0f + max_drawdown / 100.0f) - 1.0f) * 100.0f;
     const float score = gain / DDC * WR;
 
-    i_print++;
-    if (i_print == 10)
+    if (nb_done % 10 == 0)
     {
-        i_print = 0;
+        const std::lock_guard<std::mutex> lock(BEST_MUTEX);
         std::cout << "DONE: EMAs : " << ema1 << " - " << ema2 << " - " << ema3 << endl;
         const int nb_total = range_EMA2.size() * range_EMA1.size() * MAX_OPEN_TRADES_TO_TEST.size() * range_EMA3.size() * range_UP.size() * range_DOWN.size() * range_STOCH_RSI_LOWER.size();
-        std::cout << "NB tested = " << nb_tested << "/" << nb_total << endl;
-        std::cout << "Done " << std::round(float(nb_tested) / float(nb_total) * 100.0f * 100.0f) / 100.0f << " %" << endl;
+        std::cout << "NB tested = " << nb_done << "/" << nb_total << endl;
+        std::cout << "Done " << std::round(float(nb_done) / float(nb_total) * 100.0f * 100.0f) / 100.0f << " %" << endl;
         print_best_res(best);
     }
 
@@ -421,8 +399,8 @@ RUN_RESULTf PROCESS(const vector<KLINEf> &PAIRS, const int ema1, const int ema2,
         result.nb_posi_entered = NB_POSI_ENTERED;
         result.win_rate = WR;
         result.score = score;
-        result.calmar_ratio_monthly = calculate_calmar_ratio_monthly(USDT_tracking_ts, USDT_tracking, DDC);
-        result.calmar_ratio = calculate_calmar_ratio(USDT_tracking_ts, USDT_tracking, DDC);
+        result.calmar_ratio_monthly = calculate_calmar_ratio_monthly(CALENDAR, USDT_tracking_bars, USDT_tracking, DDC);
+        result.calmar_ratio = calculate_calmar_ratio(CALENDAR, USDT_tracking_bars, USDT_tracking, DDC);
         result.ema1 = ema1;
         result.ema2 = ema2;
         result.ema3 = ema3;
@@ -456,144 +434,28 @@ RUN_RESULTf PROCESS(const vector<KLINEf> &PAIRS, const int ema1, const int ema2,
     return result;
 }
 
-//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
-int super_index = 0;
-long int previous_ts = 0;
-int nb_read = 0;
-KLINEf read_input_data(const string &input_file_path)
-{
-    KLINEf kline;
-
-    ifstream myfile(input_file_path);
-    string line;
-    long int ts;
-    float op, hi, lo, cl, vol;
-    previous_ts = 0;
-    ifstream file(input_file_path);
-    string value;
-    vector<string> getInform;
-    nb_read = 0;
-    while (file.good())
-    {
-        getline(file, value);
-        value = ReplaceAll(value, ";", " ");
-        getInform.push_back(value);
-        // getInform.erase(getInform.begin()+1);
-        stringstream ss{};
-        ss << value;
-        ss >> ts >> op >> hi >> lo >> cl >> vol;
-        kline.timestamp.push_back(ts / 1000);
-        if (previous_ts == ts)
-        {
-            std::cout << "FOUND DUPLICATE TS at index " << nb_read << "; IGNORING. " << std::endl;
-            previous_ts = ts / 1000;
-            continue;
-        }
-        previous_ts = ts;
-        kline.open.push_back(op);
-        kline.high.push_back(hi);
-        kline.low.push_back(lo);
-        kline.close.push_back(cl);
-        nb_read++;
-    }
-
-    last_times[super_index] = kline.timestamp.back();
-
-    if (super_index >= 1)
-    {
-        while (last_times[super_index] != last_times[super_index - 1])
-        {
-            cout << "warning: inconsistent last times between different pairs, fixing it." << endl;
-
-            kline.timestamp.pop_back();
-            kline.open.pop_back();
-            kline.high.pop_back();
-            kline.low.pop_back();
-            kline.close.pop_back();
-
-            last_times[super_index] = kline.timestamp.back();
-        }
-    }
-
-    super_index++;
-
-    myfile.close();
-
-    kline.nb = int(kline.close.size());
-
-    std::cout << "Loaded data file. " << input_file_path << endl;
-
-    return kline;
-}
-
 //////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
-vector<uint> add_zeros(const vector<uint> &vec_in, const int nb_to_add)
-{
-    vector<uint> vec_to_add(nb_to_add, 0);
-    vec_to_add.insert(vec_to_add.end(), vec_in.begin(), vec_in.end());
-    return vec_to_add;
-}
-vector<float> add_zeros(const vector<float> &vec_in, const int nb_to_add)
-{
-    vector<float> vec_to_add(nb_to_add, 0.0);
-    vec_to_add.insert(vec_to_add.end(), vec_in.begin(), vec_in.end());
-    return vec_to_add;
-}
-//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 void INITIALIZE_DATA(vector<KLINEf> &PAIRS)
 // will modify PAIRS since it is passed as reference
 {
     std::cout << "Running INITIALIZE_DATA..." << endl;
 
-    start_indexes[0] = 400;
-
-    // find initial indexes (different starting times)
-    for (uint i = 0; i < PAIRS[0].timestamp.size(); i++)
-    {
-        for (uint ic = 1; ic < NB_PAIRS; ic++)
-        {
-            if (PAIRS[ic].timestamp[0] == PAIRS[0].timestamp[i])
-            {
-                start_indexes[ic] = start_indexes[0] + i;
-                std::cout << "Start for " + COINS[ic] << " : " << i << endl;
-            }
-        }
-    }
-
-    for (uint ic = 1; ic < NB_PAIRS; ic++)
-    {
-        const int nb_to_add = PAIRS[0].close.size() - PAIRS[ic].close.size();
-
-        PAIRS[ic].timestamp = add_zeros(PAIRS[ic].timestamp, nb_to_add);
-        PAIRS[ic].open = add_zeros(PAIRS[ic].open, nb_to_add);
-        PAIRS[ic].high = add_zeros(PAIRS[ic].high, nb_to_add);
-        PAIRS[ic].low = add_zeros(PAIRS[ic].low, nb_to_add);
-        PAIRS[ic].close = add_zeros(PAIRS[ic].close, nb_to_add);
+    // pairs trade once the indicators are warmed up on their own data
+    const uint warmup = 400;
 
-        PAIRS[ic].nb = PAIRS[0].close.size();
-
-        for (uint ii = 0; ii < start_indexes[ic] + 5; ii++)
-        {
-            PAIRS[ic].timestamp[ii] = PAIRS[0].timestamp[ii];
-        }
-    }
-
-    std::cout << "Checking consistency of sizes of datasets..." << std::endl;
-    for (uint ic = 1; ic < NB_PAIRS; ic++)
+    AXIS = align_pairs(PAIRS);
+    for (uint ic = 0; ic < NB_PAIRS; ic++)
     {
-        if (PAIRS[ic].nb != PAIRS[0].nb || PAIRS[ic].open.size() != PAIRS[0].open.size())
-        {
-            std::cout << "ERROR: incosistent size" << endl;
-            abort();
-        }
+        start_indexes[ic] = warmup + AXIS.first[ic];
+        std::cout << "Start for " + COINS[ic] << " : " << AXIS.first[ic] << endl;
+        INDICATORS[ic].store_in(INDICATOR_STORE_DIR, PAIRS[ic]);
     }
-    std::cout << "Done." << std::endl;
 }
 
 //////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
-int main()
+int main(int argc, char **argv)
 {
     const double t_begin = get_wall_time();
     std::cout << "\n-------------------------------------" << endl;
@@ -607,6 +469,10 @@ int main()
         std::cout << "  " << dataf << endl;
     }
 
+    const DATA_MODE data_mode = parse_data_mode(argc, argv);
+    if (run_data_command(data_mode, DATAFILES))
+        return 0;
+
     TA_RetCode retCode;
     retCode = TA_Initialize();
     if (retCode != TA_SUCCESS)
@@ -619,28 +485,25 @@ int main()
         std::cout << "Initialized TA-Lib !\n";
     }
 
-    vector<KLINEf> PAIRS;
-    PAIRS.reserve(NB_PAIRS);
-    for (const string &dataf : DATAFILES)
-    {
-        PAIRS.push_back(read_input_data(dataf));
-    }
+    vector<KLINEf> PAIRS = read_kline_files_parallel(DATAFILES, KLINE_TIMESTAMP | KLINE_HIGH | KLINE_LOW | KLINE_CLOSE);
+    reconcile_last_times(PAIRS, true);
 
     INITIALIZE_DATA(PAIRS); // this function modifies PAIRS
+    CALENDAR = build_calendar_index(AXIS.timestamp);
 
     best.gain_over_DDC = -100.0f;
     best.calmar_ratio = -100.0f;
     best.calmar_ratio_monthly = -100.0f;
 
-    const uint last_idx = PAIRS[0].nb - 1;
+    const uint last_idx = AXIS.nb - 1;
 
-    const int year = get_year_from_timestamp(PAIRS[0].timestamp[0]);
-    const int month = get_month_from_timestamp(PAIRS[0].timestamp[0]);
-    const int day = get_day_from_timestamp(PAIRS[0].timestamp[0]);
+    const int year = get_year_from_timestamp(AXIS.timestamp[0]);
+    const int month = get_month_from_timestamp(AXIS.timestamp[0]);
+    const int day = get_day_from_timestamp(AXIS.timestamp[0]);
 
-    const int last_year = get_year_from_timestamp(PAIRS[0].timestamp[last_idx]);
-    const int last_month = get_month_from_timestamp(PAIRS[0].timestamp[last_idx]);
-    const int last_day = get_day_from_timestamp(PAIRS[0].timestamp[last_idx]);
+    const int last_year = get_year_from_timestamp(AXIS.timestamp[last_idx]);
+    const int last_month = get_month_from_timestamp(AXIS.timestamp[last_idx]);
+    const int last_day = get_day_from_timestamp(AXIS.timestamp[last_idx]);
 
     // Display info
     std::cout << "Begin day      : " << year << "/" << month << "/" << day << endl;
@@ -658,13 +521,19 @@ int main()
     std::vector<EMA3_params> param_list{};
     param_list.reserve(range_EMA1.size() * range_EMA2.size() * range_EMA3.size() * range_UP.size() * range_DOWN.size() * MAX_OPEN_TRADES_TO_TEST.size());
 
-    for (const uint max_op_tr : MAX_OPEN_TRADES_TO_TEST)
+    // the list is built triple by triple: each (ema1, ema2, ema3) owns a block of group_size consecutive sets
+    const size_t group_size = MAX_OPEN_TRADES_TO_TEST.size() * range_UP.size() * range_DOWN.size() * range_STOCH_RSI_LOWER.size();
+    for (const int ema1 : range_EMA1)
     {
-        for (const int ema1 : range_EMA1)
+        for (const int ema2 : range_EMA2)
         {
-            for (const int ema2 : range_EMA2)
+            for (const int ema3 : range_EMA3)
             {
-                for (const int ema3 : range_EMA3)
+                if (ema1 >= ema2)
+                    continue;
+                if (ema2 >= ema3)
+                    continue;
+                for (const uint max_op_tr : MAX_OPEN_TRADES_TO_TEST)
                 {
                     for (const float up : range_UP)
                     {
@@ -672,10 +541,6 @@ int main()
                         {
                             for (const float SRSIL : range_STOCH_RSI_LOWER)
                             {
-                                if (ema1 >= ema2)
-                                    continue;
-                                if (ema2 >= ema3)
-                                    continue;
                                 const EMA3_params to_add{ema1, ema2, ema3, up, down, SRSIL, max_op_tr};
                                 param_list.push_back(to_add);
                             }
@@ -689,18 +554,48 @@ int main()
     std::cout << "Saved parameter list to test." << std::endl;
     std::cout << "Running all backtests..." << std::endl;
 
-    random_shuffle_vector_params(param_list);
+    // random order of the triples and random order within a triple, but the sets sharing a triple run together,
+    // so that the budgeted INDICATORS only need the triples in progress resident
+    vector<uint> group_order(param_list.size() / group_size), run_order(group_size);
+    std::iota(group_order.begin(), group_order.end(), 0);
+    std::iota(run_order.begin(), run_order.end(), 0);
+    std::default_random_engine shuffle_engine(std::chrono::system_clock::now().time_since_epoch().count());
+    std::shuffle(group_order.begin(), group_order.end(), shuffle_engine);
+    std::shuffle(run_order.begin(), run_order.end(), shuffle_engine);
 
-    // std::vector<std::vector<EMA3_params>> SplitedVector = SplitVector(param_list, NB_THREADS);
-
-    for (const auto para : param_list)
+    for (uint ic = 0; ic < NB_PAIRS; ic++)
     {
-        const RUN_RESULTf res = PROCESS(PAIRS, para.ema1, para.ema2, para.ema3, para.up, para.down, para.SRSIL, para.max_open_trades);
+        INDICATORS[ic].budget_bytes = INDICATOR_CACHE_BYTES / NB_PAIRS;
+        INDICATORS[ic].encoding = INDICATOR_ENCODING;
+        // %D is tested against STOCH_RSI_LOWER and crossed with %K, its input. The EMAs are compared with each other,
+        // which the compaction guard cannot check, and %K is the input of %D: both stay in float
+        INDICATORS[ic].decisions[IND_STOCHRSI_D] = {false, true, range_STOCH_RSI_LOWER};
+    }
 
-        if (res.calmar_ratio_monthly > best.calmar_ratio_monthly && res.gain_pc > 500.0f && res.gain_pc < 1000000.0f && res.nb_posi_entered >= MIN_NUMBER_OF_TRADES && res.max_DD > MIN_ALLOWED_MAX_DRAWBACK)
+    // each worker takes the next parameter set; the indicators they need are built once in INDICATORS and shared
+    std::atomic<size_t> next_param{0};
+    const auto worker = [&]()
+    {
+        for (size_t ip = next_param++; ip < param_list.size(); ip = next_param++)
         {
-            best = res;
+            const EMA3_params &para = param_list[group_order[ip / group_size] * group_size + run_order[ip % group_size]];
+            const RUN_RESULTf res = PROCESS(PAIRS, para.ema1, para.ema2, para.ema3, para.up, para.down, para.SRSIL, para.max_open_trades);
+
+            const std::lock_guard<std::mutex> lock(BEST_MUTEX);
+            if (res.calmar_ratio_monthly > best.calmar_ratio_monthly && res.gain_pc > 500.0f && res.gain_pc < 1000000.0f && res.nb_posi_entered >= MIN_NUMBER_OF_TRADES && res.max_DD > MIN_ALLOWED_MAX_DRAWBACK)
+            {
+                best = res;
+            }
         }
+    };
+    vector<std::thread> workers;
+    for (int it = 0; it < NB_THREADS; it++)
+    {
+        workers.emplace_back(worker);
+    }
+    for (std::thread &w : workers)
+    {
+        w.join();
     }
 
     print_best_res(best);
@@ -708,6 +603,16 @@ int main()
     const double t_end = get_wall_time();
 
     std::cout << "Number of backtests performed : " << nb_tested << endl;
+    uint nb_computed = 0, nb_evicted = 0, nb_kept_exact = 0;
+    for (const INDICATOR_REGISTRY &reg : INDICATORS)
+    {
+        nb_computed += reg.nb_computed;
+        nb_evicted += reg.nb_evicted;
+        nb_kept_exact += reg.nb_kept_exact;
+    }
+    std::cout << "Indicators computed / evicted : " << nb_computed << " / " << nb_evicted << endl;
+    if (INDICATOR_ENCODING != ENC_FLOAT32)
+        std::cout << "Kept in float (guard failed)  : " << nb_kept_exact << endl;
     std::cout << "Time taken                    : " << t_end - t_begin << " seconds " << endl;
     const double ram_usage = process_mem_usage();
     std::cout << "RAM usage                     : " << std::round(ram_usage * 10.0) / 10.0 << " MB" << endl;
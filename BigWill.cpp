@@ -60,6 +60,8 @@ const float STOCH_RSI_LOWER = 0.200f;
 const float WillOverSold = -85.0f;
 const float WillOverBought = -10.0f;
 uint start_indexes[NB_PAIRS];
+TIME_AXIS AXIS;          // shared timeline of PAIRS (see align_pairs)
+CALENDAR_INDEX CALENDAR; // calendar of AXIS
 
 // RANGE OF PERIDOS TO TEST
 // const int range_step = 2;
@@ -68,12 +70,11 @@ vector<int> range_AO_fast = integer_range(2, 102, 2);
 vector<int> range_AO_slow = integer_range(2, 105, 5);
 vector<int> range_EMA_fast = integer_range(2, 105, 5);
 vector<int> range_EMA_slow = integer_range(50, 310, 10);
+vector<int> range_StochRSI_window = {14};
+vector<int> range_WILLR_length = {14};
 //////////////////////////
-array<std::unordered_map<string, vector<float>>, NB_PAIRS> EMA_LISTS{};
-array<vector<float>, NB_PAIRS> StochRSI{};
-array<vector<float>, NB_PAIRS> WILLR{};
-
-array<long int, NB_PAIRS> last_times{};
+array<INDICATOR_REGISTRY, NB_PAIRS> INDICATORS{};
+array<PREFIX_SUM_SMA, NB_PAIRS> MEDIAN_PRICE_SMA{}; // the AO of any (fast, slow) is a pass of subtractions on it
 
 uint i_print = 0;
 uint nb_tested = 0;
@@ -92,6 +93,14 @@ void fill_datafile_paths()
 
 //////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
+size_t nb_combinations()
+{
+    return range_AO_slow.size() * range_AO_fast.size() * MAX_OPEN_TRADES_TO_TEST.size() * range_EMA_fast.size() * range_EMA_slow.size() *
+           range_StochRSI_window.size() * range_WILLR_length.size();
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
 void print_best_res(const RUN_RESULTf &bestt)
 {
     std::cout << "\n-------------------------------------" << endl;
@@ -100,6 +109,7 @@ void print_best_res(const RUN_RESULTf &bestt)
     std::cout << "Strategy : " << STRAT_NAME << endl;
     std::cout << "AO Fast - Slow : " << bestt.ema1 << " - " << bestt.ema2 << endl;
     std::cout << "EMA Fast - Slow : " << bestt.ema3 << " - " << bestt.ema4 << endl;
+    std::cout << "StochRSI window - WILLR length : " << bestt.stoch_window << " - " << bestt.willr_length << endl;
     std::cout << "Max Open Trades : " << bestt.max_open_trades << endl;
     std::cout << "Best Gain: " << bestt.gain_pc << "%" << endl;
     std::cout << "Porfolio : " << bestt.WALLET_VAL_USDT << "$ (started with 1000$)" << endl;
@@ -115,42 +125,30 @@ void print_best_res(const RUN_RESULTf &bestt)
 
 //////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
-bool key_exists(std::unordered_map<string, vector<float>> m, const string &ch)
-{
-    if (m.find(ch) != m.end())
-    {
-        return true;
-    }
-    else
-    {
-        return false;
-    }
-}
-
-RUN_RESULTf PROCESS(const vector<KLINEf> &PAIRS, const int fast, const int slow, int ema_fast, int ema_slow, const uint MAX_OPEN_TRADES)
+RUN_RESULTf PROCESS(const vector<KLINEf> &PAIRS, const BigWill_params &params)
 {
     nb_tested++;
 
-    for (int ic = 0; ic < NB_PAIRS; ic++)
+    const int fast = params.AO_fast;
+    const int slow = params.AO_slow;
+    const uint MAX_OPEN_TRADES = params.max_open_trades;
+
+    // indicators are computed on first use, then only their spans are read in the bar loop
+    array<const float *, NB_PAIRS> EMA_FAST, EMA_SLOW, StochRSI, WILLR;
+    for (uint ic = 0; ic < NB_PAIRS; ic++)
     {
-        const string k1 = "EMA_" + std::to_string(ema_fast);
-        const string k2 = "EMA_" + std::to_string(ema_slow);
-        if (!key_exists(EMA_LISTS[ic], k1))
-        {
-            EMA_LISTS[ic][k1] = TALIB_EMA(PAIRS[ic].close, ema_fast);
-        }
-        if (!key_exists(EMA_LISTS[ic], k2))
-        {
-            EMA_LISTS[ic][k2] = TALIB_EMA(PAIRS[ic].close, ema_slow);
-        }
+        EMA_FAST[ic] = INDICATORS[ic].span(PAIRS[ic], {IND_EMA, params.ema_f});
+        EMA_SLOW[ic] = INDICATORS[ic].span(PAIRS[ic], {IND_EMA, params.ema_s});
+        StochRSI[ic] = INDICATORS[ic].span(PAIRS[ic], {IND_STOCHRSI, params.stoch_window, 14});
+        WILLR[ic] = INDICATORS[ic].span(PAIRS[ic], {IND_WILLR, params.willr_length});
     }
 
     RUN_RESULTf result{};
 
     vector<float> USDT_tracking{};
-    vector<int> USDT_tracking_ts{};
+    vector<uint> USDT_tracking_bars{};
 
-    const uint nb_max = PAIRS[0].nb;
+    const uint nb_max = AXIS.nb;
 
     bool LAST_ITERATION = false;
     bool OPEN_LONG_CONDI = false;
@@ -172,13 +170,35 @@ RUN_RESULTf PROCESS(const vector<KLINEf> &PAIRS, const int fast, const int slow,
     for (uint ic = 0; ic < NB_PAIRS; ic++)
     {
         COIN_AMOUNTS[ic] = 0.0f;
-        AO[ic] = TALIB_AO(PAIRS[ic].high, PAIRS[ic].low, fast, slow);
+        AO[ic].resize(PAIRS[ic].nb);
+        MEDIAN_PRICE_SMA[ic].ao(fast, slow, AO[ic].data());
     }
     uint ACTIVE_POSITIONS = 0;
 
-    const uint ii_begin = start_indexes[0];
+    // the conditions apart from the take profit only depend on prices and indicators: they are computed for the whole
+    // run. The take profit depends on the open price, so the loop visits every bar while a position is open, and only
+    // the bars with an open signal otherwise
+    PAIR_SIGNALS SIGNALS(NB_PAIRS, nb_max);
+    for (uint ic = 0; ic < NB_PAIRS; ic++)
+    {
+        const float *ema_fast = EMA_FAST[ic];
+        const float *ema_slow = EMA_SLOW[ic];
+        const float *willr = WILLR[ic];
+        const float *stoch_rsi = StochRSI[ic];
+        const float *ao = AO[ic].data();
+        SIGNALS.set_pair(
+            AXIS, ic, start_indexes[ic],
+            [=](const uint jj)
+            { return (ema_fast[jj] >= ema_slow[jj]) & (willr[jj] < WillOverSold) & (ao[jj] > 0.0f) & (ao[jj - 1] > ao[jj]); },
+            [=](const uint jj)
+            { return ((ao[jj] < 0.0f) & (stoch_rsi[jj] > STOCH_RSI_LOWER)) | (willr[jj] > WillOverBought); });
+    }
+    const auto next_bar = [&](const uint ii)
+    { return ACTIVE_POSITIONS > 0 ? ii : SIGNALS.next_event(ii, COIN_AMOUNTS.data(), true); };
+
+    const uint ii_begin = *std::min_element(start_indexes, start_indexes + NB_PAIRS);
 
-    for (uint ii = ii_begin + 1; ii < nb_max; ii++)
+    for (uint ii = next_bar(ii_begin + 1); ii < nb_max; ii = next_bar(ii + 1))
     {
         if (ii == nb_max - 1)
             LAST_ITERATION = true;
@@ -187,27 +207,28 @@ RUN_RESULTf PROCESS(const vector<KLINEf> &PAIRS, const int fast, const int slow,
         // For all pairs, check to close / open positions
         for (uint ic = 0; ic < NB_PAIRS; ic++)
         {
-            if (ii < start_indexes[ic])
+            if (ii < start_indexes[ic] || AXIS.is_gap(ic, ii))
                 continue;
+            const uint jj = AXIS.local(ic, ii); // bar ii of the axis in the pair's own data
 
             // conditions for open / close position
 
             bool TP_condition = false;
             if (COIN_AMOUNTS[ic] > 0)
             {
-                const float pc_gain = (PAIRS[ic].high[ii] - price_position_open[ic]) / price_position_open[ic] * 100.0f;
+                const float pc_gain = (PAIRS[ic].high[jj] - price_position_open[ic]) / price_position_open[ic] * 100.0f;
                 TP_condition = pc_gain > 15.0f;
             }
 
-            OPEN_LONG_CONDI = EMA_LISTS[ic]["EMA_" + std::to_string(ema_fast)][ii] >= EMA_LISTS[ic]["EMA_" + std::to_string(ema_slow)][ii] && WILLR[ic][ii] < WillOverSold && AO[ic][ii] > 0.0f && AO[ic][ii - 1] > AO[ic][ii];
-            CLOSE_LONG_CONDI = (AO[ic][ii] < 0.0f && StochRSI[ic][ii] > STOCH_RSI_LOWER) || WILLR[ic][ii] > WillOverBought || TP_condition;
+            OPEN_LONG_CONDI = SIGNALS.open(ic, ii);
+            CLOSE_LONG_CONDI = SIGNALS.close(ic, ii) || TP_condition;
 
             // IT IS IMPORTANT TO CHECK FIRST FOR CLOSING POSITION AND ONLY THEN FOR OPENING POSITION
 
             // CLOSE LONG
             if (COIN_AMOUNTS[ic] > 0.0f && (CLOSE_LONG_CONDI || LAST_ITERATION))
             {
-                const float to_add = COIN_AMOUNTS[ic] * PAIRS[ic].close[ii];
+                const float to_add = COIN_AMOUNTS[ic] * PAIRS[ic].close[jj];
                 USDT_amount += to_add;
                 COIN_AMOUNTS[ic] = 0.0f;
 
@@ -218,7 +239,7 @@ RUN_RESULTf PROCESS(const vector<KLINEf> &PAIRS, const int fast, const int slow,
                 USDT_amount -= fe;
                 total_fees_paid_USDT += fe;
                 //
-                if (PAIRS[ic].close[ii] >= price_position_open[ic])
+                if (PAIRS[ic].close[jj] >= price_position_open[ic])
                 {
                     nb_profit++;
                 }
@@ -232,17 +253,17 @@ RUN_RESULTf PROCESS(const vector<KLINEf> &PAIRS, const int fast, const int slow,
             // OPEN LONG
             if (COIN_AMOUNTS[ic] == 0.0f && OPEN_LONG_CONDI && LAST_ITERATION == false && ACTIVE_POSITIONS < MAX_OPEN_TRADES)
             {
-                price_position_open[ic] = PAIRS[ic].close[ii];
+                price_position_open[ic] = PAIRS[ic].close[jj];
 
                 const float usdMultiplier = 1.0f / float(MAX_OPEN_TRADES - ACTIVE_POSITIONS);
 
-                COIN_AMOUNTS[ic] = USDT_amount * usdMultiplier / PAIRS[ic].close[ii];
+                COIN_AMOUNTS[ic] = USDT_amount * usdMultiplier / PAIRS[ic].close[jj];
                 USDT_amount -= USDT_amount * usdMultiplier;
 
                 // apply FEEs
                 const float fe = COIN_AMOUNTS[ic] * FEE / 100.0f;
                 COIN_AMOUNTS[ic] -= fe;
-                total_fees_paid_USDT += fe * PAIRS[ic].close[ii];
+                total_fees_paid_USDT += fe * PAIRS[ic].close[jj];
                 //
 
                 ACTIVE_POSITIONS++;
@@ -255,7 +276,7 @@ RUN_RESULTf PROCESS(const vector<KLINEf> &PAIRS, const int fast, const int slow,
         {
             array<float, NB_PAIRS> closes{};
             for (uint ic = 0; ic < NB_PAIRS; ic++)
-                closes[ic] = PAIRS[ic].close[ii];
+                closes[ic] = AXIS.listed(ic, ii) ? PAIRS[ic].close[AXIS.local(ic, ii)] : 0.0f;
 
             WALLET_VAL_USDT = USDT_amount + vector_product(COIN_AMOUNTS, closes);
             if (WALLET_VAL_USDT > MAX_WALLET_VAL_USDT)
@@ -266,13 +287,13 @@ RUN_RESULTf PROCESS(const vector<KLINEf> &PAIRS, const int fast, const int slow,
                 max_drawdown = pc_change_with_max;
 
             USDT_tracking.push_back(WALLET_VAL_USDT);
-            USDT_tracking_ts.push_back(PAIRS[0].timestamp[ii]);
+            USDT_tracking_bars.push_back(ii);
         }
     }
 
     array<float, NB_PAIRS> last_closes{};
     for (uint ic = 0; ic < NB_PAIRS; ic++)
-        last_closes[ic] = PAIRS[ic].close[nb_max - 1];
+        last_closes[ic] = PAIRS[ic].close[PAIRS[ic].nb - 1];
 
     WALLET_VAL_USDT = USDT_amount + vector_product(COIN_AMOUNTS, last_closes);
 
@@ -286,8 +307,8 @@ RUN_RESULTf PROCESS(const vector<KLINEf> &PAIRS, const int fast, const int slow,
     {
         i_print = 0;
         std::cout << "DONE: Fast - Slow : " << fast << " - " << slow << endl;
-        std::cout << "NB tested = " << nb_tested << "/" << range_AO_slow.size() * range_AO_fast.size() * MAX_OPEN_TRADES_TO_TEST.size() * range_EMA_fast.size() * range_EMA_slow.size() << endl;
-        std::cout << "Done " << std::round(float(nb_tested) / float(range_AO_slow.size() * range_AO_fast.size() * MAX_OPEN_TRADES_TO_TEST.size() * range_EMA_fast.size() * range_EMA_slow.size()) * 100.0f * 100.0f) / 100.0f << " %" << endl;
+        std::cout << "NB tested = " << nb_tested << "/" << nb_combinations() << endl;
+        std::cout << "Done " << std::round(float(nb_tested) / float(nb_combinations()) * 100.0f * 100.0f) / 100.0f << " %" << endl;
         print_best_res(best);
     }
 
@@ -298,165 +319,65 @@ RUN_RESULTf PROCESS(const vector<KLINEf> &PAIRS, const int fast, const int slow,
     result.nb_posi_entered = NB_POSI_ENTERED;
     result.win_rate = WR;
     result.score = score;
-    result.calmar_ratio = calculate_calmar_ratio(USDT_tracking_ts, USDT_tracking, DDC);
+    result.calmar_ratio = calculate_calmar_ratio(CALENDAR, USDT_tracking_bars, USDT_tracking, DDC);
     result.ema1 = fast;
     result.ema2 = slow;
-    result.ema3 = ema_fast;
-    result.ema4 = ema_slow;
+    result.ema3 = params.ema_f;
+    result.ema4 = params.ema_s;
+    result.stoch_window = params.stoch_window;
+    result.willr_length = params.willr_length;
     result.total_fees_paid = total_fees_paid_USDT;
     result.max_open_trades = MAX_OPEN_TRADES;
 
     return result;
 }
 
-//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
-int super_index = 0;
-long int previous_ts = 0;
-int nb_read = 0;
-KLINEf read_input_data(const string &input_file_path)
-{
-    KLINEf kline;
-
-    ifstream myfile(input_file_path);
-    string line;
-    long int ts;
-    float op, hi, lo, cl, vol;
-    previous_ts = 0;
-    ifstream file(input_file_path);
-    string value;
-    vector<string> getInform;
-    nb_read=0;
-    while (file.good())
-    {
-        getline(file, value);
-        value = ReplaceAll(value, ";", " ");
-        getInform.push_back(value);
-        // getInform.erase(getInform.begin()+1);
-        stringstream ss{};
-        ss << value;
-        ss >> ts >> op >> hi >> lo >> cl >> vol;
-        kline.timestamp.push_back(ts / 1000);
-        if (previous_ts==ts) {
-            std::cout << "FOUND DUPLICATE TS at index " << nb_read << "; INGNORING. "<< std::endl;
-            previous_ts = ts / 1000;
-            continue;
-        }
-        previous_ts = ts;
-        kline.open.push_back(op);
-        kline.high.push_back(hi);
-        kline.low.push_back(lo);
-        kline.close.push_back(cl);
-        nb_read++;
-    }
-
-    last_times[super_index] = kline.timestamp.back();
-
-    // cout << last_times[super_index] << endl;
-    // cout << super_index << endl;
-
-    if (super_index >= 1)
-    {
-        if (last_times[super_index] != last_times[super_index - 1])
-        {
-            cout << "Error: inconsistent last times between different pairs." << endl;
-            std::abort();
-        }
-    }
-
-    super_index++;
-
-    myfile.close();
-
-    kline.nb = int(kline.close.size());
-
-    std::cout << "Loaded data file. " << input_file_path << endl;
-    return kline;
-}
-
 //////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
-vector<uint> add_zeros(const vector<uint> &vec_in, const int nb_to_add)
-{
-    vector<uint> vec_to_add(nb_to_add, 0);
-    vec_to_add.insert(vec_to_add.end(), vec_in.begin(), vec_in.end());
-    return vec_to_add;
-}
-vector<float> add_zeros(const vector<float> &vec_in, const int nb_to_add)
-{
-    vector<float> vec_to_add(nb_to_add, 0.0);
-    vec_to_add.insert(vec_to_add.end(), vec_in.begin(), vec_in.end());
-    return vec_to_add;
-}
-//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 void INITIALIZE_DATA(vector<KLINEf> &PAIRS)
 // will modify PAIRS since it is passed as reference
 {
     std::cout << "Running INITIALIZE_DATA..." << endl;
 
-    start_indexes[0] = 400;
+    // pairs trade once the indicators are warmed up on their own data
+    const uint warmup = 400;
 
-    // find initial indexes (different starting times)
-    for (uint i = 0; i < PAIRS[0].timestamp.size(); i++)
+    AXIS = align_pairs(PAIRS);
+    for (uint ic = 0; ic < NB_PAIRS; ic++)
     {
-        for (uint ic = 1; ic < NB_PAIRS; ic++)
-        {
-            if (PAIRS[ic].timestamp[0] == PAIRS[0].timestamp[i])
-            {
-                start_indexes[ic] = start_indexes[0] + i;
-                std::cout << "Start for " + COINS[ic] << " : " << i << endl;
-            }
-        }
+        start_indexes[ic] = warmup + AXIS.first[ic];
+        std::cout << "Start for " + COINS[ic] << " : " << AXIS.first[ic] << endl;
+        INDICATORS[ic].store_in(INDICATOR_STORE_DIR, PAIRS[ic]);
     }
 
-    for (uint ic = 1; ic < NB_PAIRS; ic++)
+    // all the StochRSI windows and WILLR lengths of a pair are computed in one rolling min / max pass each
+    vector<INDICATOR_SPEC> specs;
+    for (const int window : range_StochRSI_window)
     {
-        const int nb_to_add = PAIRS[0].close.size() - PAIRS[ic].close.size();
-
-        PAIRS[ic].timestamp = add_zeros(PAIRS[ic].timestamp, nb_to_add);
-        PAIRS[ic].open = add_zeros(PAIRS[ic].open, nb_to_add);
-        PAIRS[ic].high = add_zeros(PAIRS[ic].high, nb_to_add);
-        PAIRS[ic].low = add_zeros(PAIRS[ic].low, nb_to_add);
-        PAIRS[ic].close = add_zeros(PAIRS[ic].close, nb_to_add);
-
-        PAIRS[ic].nb = PAIRS[0].close.size();
-
-        for (uint ii = 0; ii < start_indexes[ic] + 5; ii++)
-        {
-            PAIRS[ic].timestamp[ii] = PAIRS[0].timestamp[ii];
-        }
+        specs.push_back({IND_STOCHRSI, window, 14});
     }
-
-    std::cout << "Checking consistency of sizes of datasets..." << std::endl;
-    for (uint ic = 1; ic < NB_PAIRS; ic++)
+    for (const int length : range_WILLR_length)
     {
-        if (PAIRS[ic].nb != PAIRS[0].nb || PAIRS[ic].open.size() != PAIRS[0].open.size())
-        {
-            std::cout << "ERROR: incosistent size" << endl;
-            abort();
-        }
+        specs.push_back({IND_WILLR, length});
     }
-    std::cout << "Done." << std::endl;
-
-    //
-
     for (uint ic = 0; ic < NB_PAIRS; ic++)
     {
-        StochRSI[ic] = TALIB_STOCHRSI_not_averaged(PAIRS[ic].close, 14, 14);
+        INDICATORS[ic].resolve(PAIRS[ic], specs);
     }
-    cout << "Calculated STOCHRSI." << endl;
+    cout << "Calculated STOCHRSI and WILLR." << endl;
 
     for (uint ic = 0; ic < NB_PAIRS; ic++)
     {
-        WILLR[ic] = TALIB_WILLR(PAIRS[ic].high, PAIRS[ic].low, PAIRS[ic].close, 14);
+        MEDIAN_PRICE_SMA[ic] = PREFIX_SUM_SMA(INDICATORS[ic].span(PAIRS[ic], {IND_MEDIAN_PRICE}), PAIRS[ic].nb);
     }
-    cout << "Calculated WILLR." << endl;
+    cout << "Calculated median price sums." << endl;
 
     std::cout << "Initialized calculations." << endl;
 }
 
 //////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
-int main()
+int main(int argc, char **argv)
 {
     const double t_begin = get_wall_time();
     std::cout << "\n-------------------------------------" << endl;
@@ -470,6 +391,10 @@ int main()
         std::cout << "  " << dataf << endl;
     }
 
+    const DATA_MODE data_mode = parse_data_mode(argc, argv);
+    if (run_data_command(data_mode, DATAFILES))
+        return 0;
+
     TA_RetCode retCode;
     retCode = TA_Initialize();
     if (retCode != TA_SUCCESS)
@@ -482,27 +407,24 @@ int main()
         std::cout << "Initialized TA-Lib !\n";
     }
 
-    vector<KLINEf> PAIRS;
-    PAIRS.reserve(NB_PAIRS);
-    for (const string &dataf : DATAFILES)
-    {
-        PAIRS.push_back(read_input_data(dataf));
-    }
+    vector<KLINEf> PAIRS = read_kline_files_parallel(DATAFILES, KLINE_TIMESTAMP | KLINE_HIGH | KLINE_LOW | KLINE_CLOSE);
+    reconcile_last_times(PAIRS, false);
 
     INITIALIZE_DATA(PAIRS); // this function modifies PAIRS
+    CALENDAR = build_calendar_index(AXIS.timestamp);
 
     best.gain_over_DDC = -100.0f;
     best.calmar_ratio = -100.0f;
 
-    const uint last_idx = PAIRS[0].nb - 1;
+    const uint last_idx = AXIS.nb - 1;
 
-    const int year = get_year_from_timestamp(PAIRS[0].timestamp[0]);
-    const int month = get_month_from_timestamp(PAIRS[0].timestamp[0]);
-    const int day = get_day_from_timestamp(PAIRS[0].timestamp[0]);
+    const int year = get_year_from_timestamp(AXIS.timestamp[0]);
+    const int month = get_month_from_timestamp(AXIS.timestamp[0]);
+    const int day = get_day_from_timestamp(AXIS.timestamp[0]);
 
-    const int last_year = get_year_from_timestamp(PAIRS[0].timestamp[last_idx]);
-    const int last_month = get_month_from_timestamp(PAIRS[0].timestamp[last_idx]);
-    const int last_day = get_day_from_timestamp(PAIRS[0].timestamp[last_idx]);
+    const int last_year = get_year_from_timestamp(AXIS.timestamp[last_idx]);
+    const int last_month = get_month_from_timestamp(AXIS.timestamp[last_idx]);
+    const int last_day = get_day_from_timestamp(AXIS.timestamp[last_idx]);
 
     // Display info
     std::cout << "Begin day      : " << year << "/" << month << "/" << day << endl;
@@ -521,7 +443,7 @@ int main()
 
     // MAIN LOOP
     std::vector<BigWill_params> param_list{};
-    param_list.reserve(range_AO_slow.size() * range_AO_fast.size() * MAX_OPEN_TRADES_TO_TEST.size());
+    param_list.reserve(nb_combinations());
 
     for (const uint max_op_tr : MAX_OPEN_TRADES_TO_TEST)
     {
@@ -536,9 +458,15 @@ int main()
                         if (std::abs(fast - slow) < 7 || fast > slow)
                             continue;
 
-                        const BigWill_params to_add{fast, slow, ema_f, ema_s, max_op_tr};
+                        for (const int stoch_window : range_StochRSI_window)
+                        {
+                            for (const int willr_length : range_WILLR_length)
+                            {
+                                const BigWill_params to_add{fast, slow, ema_f, ema_s, stoch_window, willr_length, max_op_tr};
 
-                        param_list.push_back(to_add);
+                                param_list.push_back(to_add);
+                            }
+                        }
                     }
                 }
             }
@@ -552,7 +480,7 @@ int main()
 
     for (const auto para : param_list)
     {
-        const RUN_RESULTf res = PROCESS(PAIRS, para.AO_fast, para.AO_slow, para.ema_f, para.ema_s, para.max_open_trades);
+        const RUN_RESULTf res = PROCESS(PAIRS, para);
 
         if (res.calmar_ratio > best.calmar_ratio && res.gain_pc < 1000000.0f && res.nb_posi_entered >= MIN_NUMBER_OF_TRADES && res.max_DD > MIN_ALLOWED_MAX_DRAWBACK)
         {
@@ -36,6 +36,8 @@ const float USDT_amount_initial = 1000.0f;
 const uint MIN_NUMBER_OF_TRADES = 100;         // minimum number of trades required (to avoid some noise / lucky circunstances)
 const float MIN_ALLOWED_MAX_DRAWBACK = -33.0f; // %
 uint start_indexes[NB_PAIRS];
+TIME_AXIS AXIS;          // shared timeline of PAIRS (see align_pairs)
+CALENDAR_INDEX CALENDAR; // calendar of AXIS
 
 // RANGE OF EMA PERIDOS TO TESTs
 const int period_max = 600;
@@ -43,11 +45,10 @@ const int period_max = 600;
 // vector<int> range_EMA = {180};
 vector<int> range_ema_fast = integer_range(2, 200 + 4, 2);
 vector<int> range_ema_slow = integer_range(70, period_max + 4, 2);
+const vector<int> range_SuperTrend_window = {15};
+const vector<float> range_SuperTrend_multiplier = {5.0f};
 //////////////////////////
-array<std::unordered_map<string, vector<float>>, NB_PAIRS> EMA_LISTS{};
-array<SuperTrend, NB_PAIRS> SuperTrend_LISTS{};
-
-array<long int, NB_PAIRS> last_times{};
+array<INDICATOR_REGISTRY, NB_PAIRS> INDICATORS{};
 
 uint i_print = 0;
 uint nb_tested = 0;
@@ -56,6 +57,14 @@ RUN_RESULTf best{};
 
 //////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
+size_t nb_combinations()
+{
+    return range_ema_slow.size() * range_ema_fast.size() * range_SuperTrend_window.size() * range_SuperTrend_multiplier.size() *
+           MAX_OPEN_TRADES_TO_TEST.size();
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
 void print_best_res(const RUN_RESULTf &bestt)
 {
     std::cout << "\n-------------------------------------" << endl;
@@ -63,6 +72,7 @@ void print_best_res(const RUN_RESULTf &bestt)
     std::cout << "-------------------------------------" << endl;
     std::cout << "Strategy : " << STRAT_NAME << endl;
     std::cout << "EMAs : " << bestt.ema1 << " " << bestt.ema2 << endl;
+    std::cout << "SuperTrend ATR window - multiplier : " << bestt.atr_window << " - " << bestt.atr_multi << endl;
     std::cout << "Max Open Trades : " << bestt.max_open_trades << endl;
     std::cout << "Best Gain: " << bestt.gain_pc << "%" << endl;
     std::cout << "Porfolio : " << bestt.WALLET_VAL_USDT << "$ (started with 1000$)" << endl;
@@ -79,16 +89,16 @@ void print_best_res(const RUN_RESULTf &bestt)
 
 //////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
-RUN_RESULTf PROCESS(const vector<KLINEf> &PAIRS, const int ema_f, const int ema_s, const uint MAX_OPEN_TRADES)
+RUN_RESULTf PROCESS(const vector<KLINEf> &PAIRS, const int ema_f, const int ema_s, const int atr_window, const float atr_multi, const uint MAX_OPEN_TRADES)
 {
     nb_tested++;
 
     RUN_RESULTf result{};
 
     vector<float> USDT_tracking{};
-    vector<int> USDT_tracking_ts{};
+    vector<uint> USDT_tracking_bars{};
 
-    const uint nb_max = PAIRS[0].nb;
+    const uint nb_max = AXIS.nb;
 
     bool LAST_ITERATION = false;
     bool OPEN_LONG_CONDI = false;
@@ -112,9 +122,38 @@ RUN_RESULTf PROCESS(const vector<KLINEf> &PAIRS, const int ema_f, const int ema_
     }
     uint ACTIVE_POSITIONS = 0;
 
-    const uint ii_begin = start_indexes[0];
+    // EMAs and SuperTrend directions of this run, resolved once: the bar loop only reads spans
+    array<const float *, NB_PAIRS> EMA_FAST, EMA_SLOW, SUPERTREND;
+    for (uint ic = 0; ic < NB_PAIRS; ic++)
+    {
+        EMA_FAST[ic] = INDICATORS[ic].span(PAIRS[ic], {IND_EMA, ema_f});
+        EMA_SLOW[ic] = INDICATORS[ic].span(PAIRS[ic], {IND_EMA, ema_s});
+        SUPERTREND[ic] = INDICATORS[ic].span(PAIRS[ic], supertrend_dir_spec(atr_window, atr_multi));
+    }
 
-    for (uint ii = ii_begin; ii < nb_max; ii++)
+    // the conditions only depend on prices and indicators: they are computed for the whole run, then the loop visits the
+    // bars where a position can open or close
+    PAIR_SIGNALS SIGNALS(NB_PAIRS, nb_max);
+    for (uint ic = 0; ic < NB_PAIRS; ic++)
+    {
+        const float *low = PAIRS[ic].low.data();
+        const float *high = PAIRS[ic].high.data();
+        const float *ema_fast = EMA_FAST[ic];
+        const float *ema_slow = EMA_SLOW[ic];
+        const float *supertrend = SUPERTREND[ic];
+        SIGNALS.set_pair(
+            AXIS, ic, start_indexes[ic],
+            [=](const uint jj)
+            { return (ema_fast[jj] > ema_slow[jj]) & (supertrend[jj] > 0.0f) & (low[jj] < ema_fast[jj]); },
+            [=](const uint jj)
+            { return ((ema_fast[jj] < ema_slow[jj]) | (supertrend[jj] < 0.0f)) & (high[jj] > ema_fast[jj]); });
+    }
+    const auto next_bar = [&](const uint ii)
+    { return SIGNALS.next_event(ii, COIN_AMOUNTS.data(), ACTIVE_POSITIONS < MAX_OPEN_TRADES); };
+
+    const uint ii_begin = *std::min_element(start_indexes, start_indexes + NB_PAIRS);
+
+    for (uint ii = next_bar(ii_begin); ii < nb_max; ii = next_bar(ii + 1))
     {
         if (ii == nb_max - 1)
             LAST_ITERATION = true;
@@ -123,20 +162,21 @@ RUN_RESULTf PROCESS(const vector<KLINEf> &PAIRS, const int ema_f, const int ema_
         // For all pairs, check to close / open positions
         for (uint ic = 0; ic < NB_PAIRS; ic++)
         {
-            if (ii < start_indexes[ic])
+            if (ii < start_indexes[ic] || AXIS.is_gap(ic, ii))
                 continue;
+            const uint jj = AXIS.local(ic, ii); // bar ii of the axis in the pair's own data
 
             // conditions for open / close position
 
-            OPEN_LONG_CONDI = EMA_LISTS[ic]["EMA_" + std::to_string(ema_f)][ii] > EMA_LISTS[ic]["EMA_" + std::to_string(ema_s)][ii] && SuperTrend_LISTS[ic].supertrend[ii] == 1 && PAIRS[ic].low[ii] < EMA_LISTS[ic]["EMA_" + std::to_string(ema_f)][ii];
-            CLOSE_LONG_CONDI = (EMA_LISTS[ic]["EMA_" + std::to_string(ema_f)][ii] < EMA_LISTS[ic]["EMA_" + std::to_string(ema_s)][ii] || SuperTrend_LISTS[ic].supertrend[ii] == -1) && PAIRS[ic].high[ii] > EMA_LISTS[ic]["EMA_" + std::to_string(ema_f)][ii];
+            OPEN_LONG_CONDI = SIGNALS.open(ic, ii);
+            CLOSE_LONG_CONDI = SIGNALS.close(ic, ii);
 
             // IT IS IMPORTANT TO CHECK FIRST FOR CLOSING POSITION AND ONLY THEN FOR OPENING POSITION
 
             // CLOSE LONG
             if (COIN_AMOUNTS[ic] > 0.0f && (CLOSE_LONG_CONDI || LAST_ITERATION))
             {
-                const float to_add = COIN_AMOUNTS[ic] * PAIRS[ic].close[ii];
+                const float to_add = COIN_AMOUNTS[ic] * PAIRS[ic].close[jj];
                 USDT_amount += to_add;
                 COIN_AMOUNTS[ic] = 0.0f;
 
@@ -147,7 +187,7 @@ RUN_RESULTf PROCESS(const vector<KLINEf> &PAIRS, const int ema_f, const int ema_
                 USDT_amount -= fe;
                 total_fees_paid_USDT += fe;
                 //
-                if (PAIRS[ic].close[ii] >= price_position_open[ic])
+                if (PAIRS[ic].close[jj] >= price_position_open[ic])
                 {
                     nb_profit++;
                 }
@@ -161,17 +201,17 @@ RUN_RESULTf PROCESS(const vector<KLINEf> &PAIRS, const int ema_f, const int ema_
             // OPEN LONG
             if (COIN_AMOUNTS[ic] == 0.0f && OPEN_LONG_CONDI && LAST_ITERATION == false && ACTIVE_POSITIONS < MAX_OPEN_TRADES)
             {
-                price_position_open[ic] = PAIRS[ic].close[ii];
+                price_position_open[ic] = PAIRS[ic].close[jj];
 
                 const float usdMultiplier = 1.0f / float(MAX_OPEN_TRADES - ACTIVE_POSITIONS);
 
-                COIN_AMOUNTS[ic] = USDT_amount * usdMultiplier / PAIRS[ic].close[ii];
+                COIN_AMOUNTS[ic] = USDT_amount * usdMultiplier / PAIRS[ic].close[jj];
                 USDT_amount -= USDT_amount * usdMultiplier;
 
                 // apply FEEs
                 const float fe = COIN_AMOUNTS[ic] * FEE / 100.0f;
                 COIN_AMOUNTS[ic] -= fe;
-                total_fees_paid_USDT += fe * PAIRS[ic].close[ii];
+                total_fees_paid_USDT += fe * PAIRS[ic].close[jj];
                 //
 
                 ACTIVE_POSITIONS++;
@@ -184,7 +224,7 @@ RUN_RESULTf PROCESS(const vector<KLINEf> &PAIRS, const int ema_f, const int ema_
         {
             array<float, NB_PAIRS> closes{};
             for (uint ic = 0; ic < NB_PAIRS; ic++)
-                closes[ic] = PAIRS[ic].close[ii];
+                closes[ic] = AXIS.listed(ic, ii) ? PAIRS[ic].close[AXIS.local(ic, ii)] : 0.0f;
 
             WALLET_VAL_USDT = USDT_amount + vector_product(COIN_AMOUNTS, closes);
             if (WALLET_VAL_USDT > MAX_WALLET_VAL_USDT)
@@ -195,13 +235,13 @@ RUN_RESULTf PROCESS(const vector<KLINEf> &PAIRS, const int ema_f, const int ema_
                 max_drawdown = pc_change_with_max;
 
             USDT_tracking.push_back(WALLET_VAL_USDT);
-            USDT_tracking_ts.push_back(PAIRS[0].timestamp[ii]);
+            USDT_tracking_bars.push_back(ii);
         }
     }
 
     array<float, NB_PAIRS> last_closes{};
     for (uint ic = 0; ic < NB_PAIRS; ic++)
-        last_closes[ic] = PAIRS[ic].close[nb_max - 1];
+        last_closes[ic] = PAIRS[ic].close[PAIRS[ic].nb - 1];
 
     WALLET_VAL_USDT = USDT_amount + vector_product(COIN_AMOUNTS, last_closes);
 
@@ -215,8 +255,8 @@ RUN_RESULTf PROCESS(const vector<KLINEf> &PAIRS, const int ema_f, const int ema_
     {
         i_print = 0;
         std::cout << "DONE: EMAs: " << ema_f << " " << ema_s << endl;
-        std::cout << "NB tested = " << nb_tested << "/" << range_ema_slow.size() * range_ema_fast.size() * MAX_OPEN_TRADES_TO_TEST.size() << endl;
-        std::cout << "Done " << std::round(float(nb_tested) / float(range_ema_slow.size() * range_ema_fast.size() * MAX_OPEN_TRADES_TO_TEST.size()) * 100.0 * 100.0) / 100.0 << " %" << endl;
+        std::cout << "NB tested = " << nb_tested << "/" << nb_combinations() << endl;
+        std::cout << "Done " << std::round(float(nb_tested) / float(nb_combinations()) * 100.0 * 100.0) / 100.0 << " %" << endl;
         print_best_res(best);
     }
 
@@ -227,125 +267,32 @@ RUN_RESULTf PROCESS(const vector<KLINEf> &PAIRS, const int ema_f, const int ema_
     result.nb_posi_entered = NB_POSI_ENTERED;
     result.win_rate = WR;
     result.score = score;
-    result.calmar_ratio = calculate_calmar_ratio(USDT_tracking_ts, USDT_tracking, DDC);
+    result.calmar_ratio = calculate_calmar_ratio(CALENDAR, USDT_tracking_bars, USDT_tracking, DDC);
     result.ema1 = ema_f;
     result.ema2 = ema_s;
+    result.atr_window = atr_window;
+    result.atr_multi = atr_multi;
     result.total_fees_paid = total_fees_paid_USDT;
     result.max_open_trades = MAX_OPEN_TRADES;
 
     return result;
 }
 
-//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
-int super_index = 0;
-long int previous_ts = 0;
-int nb_read = 0;
-KLINEf read_input_data(const string &input_file_path)
-{
-    KLINEf kline;
-
-    ifstream myfile(input_file_path);
-    string line;
-    long int ts;
-    float op, hi, lo, cl, vol;
-    previous_ts = 0;
-    ifstream file(input_file_path);
-    string value;
-    vector<string> getInform;
-    nb_read=0;
-    while (file.good())
-    {
-        getline(file, value);
-        value = ReplaceAll(value, ";", " ");
-        getInform.push_back(value);
-        // getInform.erase(getInform.begin()+1);
-        stringstream ss{};
-        ss << value;
-        ss >> ts >> op >> hi >> lo >> cl >> vol;
-        kline.timestamp.push_back(ts / 1000);
-        if (previous_ts==ts) {
-            std::cout << "FOUND DUPLICATE TS at index " << nb_read << "; INGNORING. "<< std::endl;
-            previous_ts = ts / 1000;
-            continue;
-        }
-        previous_ts = ts;
-        kline.open.push_back(op);
-        kline.high.push_back(hi);
-        kline.low.push_back(lo);
-        kline.close.push_back(cl);
-        nb_read++;
-    }
-
-    last_times[super_index] = kline.timestamp.back();
-
-    // cout << last_times[super_index] << endl;
-    // cout << super_index << endl;
-
-    if (super_index >= 1)
-    {
-        if (last_times[super_index] != last_times[super_index - 1])
-        {
-            cout << "Error: inconsistent last times between different pairs." << endl;
-            std::abort();
-        }
-    }
-
-    super_index++;
-
-    myfile.close();
-
-    kline.nb = int(kline.close.size());
-
-    std::cout << "Loaded data file." << endl;
-    return kline;
-}
-
 //////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 void INITIALIZE_DATA(vector<KLINEf> &PAIRS)
 // will modify PAIRS since it is passed as reference
 {
     std::cout << "Running INITIALIZE_DATA..." << endl;
 
-    start_indexes[0] = find_max(range_ema_slow) + 2;
-
-    // find initial indexes (different starting times)
-    for (uint i = 0; i < PAIRS[0].timestamp.size(); i++)
-    {
-        for (uint ic = 1; ic < NB_PAIRS; ic++)
-        {
-            if (PAIRS[ic].timestamp[0] == PAIRS[0].timestamp[i])
-            {
-                start_indexes[ic] = start_indexes[0] + i;
-                std::cout << "Start for " + COINS[ic] << " : " << i << endl;
-            }
-        }
-    }
-
-    for (uint ic = 1; ic < NB_PAIRS; ic++)
-    {
-        while (PAIRS[ic].close.size() < PAIRS[0].close.size())
-        {
-            PAIRS[ic].timestamp.insert(PAIRS[ic].timestamp.begin(), 0);
-            PAIRS[ic].open.insert(PAIRS[ic].open.begin(), 0.0f);
-            PAIRS[ic].high.insert(PAIRS[ic].high.begin(), 0.0f);
-            PAIRS[ic].low.insert(PAIRS[ic].low.begin(), 0.0f);
-            PAIRS[ic].close.insert(PAIRS[ic].close.begin(), 0.0f);
-            PAIRS[ic].nb++;
-        }
-
-        for (uint ii = 0; ii < start_indexes[ic] + 5; ii++)
-        {
-            PAIRS[ic].timestamp[ii] = PAIRS[0].timestamp[ii];
-        }
-    }
+    // pairs trade once the indicators are warmed up on their own data
+    const uint warmup = find_max(range_ema_slow) + 2;
 
-    for (uint ic = 1; ic < NB_PAIRS; ic++)
+    AXIS = align_pairs(PAIRS);
+    for (uint ic = 0; ic < NB_PAIRS; ic++)
     {
-        if (PAIRS[ic].nb != PAIRS[0].nb || PAIRS[ic].open.size() != PAIRS[0].open.size())
-        {
-            std::cout << "ERROR: incosistent size" << endl;
-            abort();
-        }
+        start_indexes[ic] = warmup + AXIS.first[ic];
+        std::cout << "Start for " + COINS[ic] << " : " << AXIS.first[ic] << endl;
+        INDICATORS[ic].store_in(INDICATOR_STORE_DIR, PAIRS[ic]);
     }
 
     //
@@ -354,7 +301,16 @@ void INITIALIZE_DATA(vector<KLINEf> &PAIRS)
         std::cout << "Calculating for " << COINS[ic] << endl;
 
         // std::cout << "Calculated STOCHRSI." << endl;
-        SuperTrend_LISTS[ic] = TALIB_SuperTrend(PAIRS[ic].high, PAIRS[ic].low, PAIRS[ic].close, 15, 5);
+        // the whole SuperTrend grid shares one true range pass and one ATR per window
+        vector<INDICATOR_SPEC> supertrend_specs;
+        for (const int window : range_SuperTrend_window)
+        {
+            for (const float multiplier : range_SuperTrend_multiplier)
+            {
+                supertrend_specs.push_back(supertrend_dir_spec(window, multiplier));
+            }
+        }
+        INDICATORS[ic].resolve(PAIRS[ic], supertrend_specs);
         vector<int> merged(range_ema_slow.size() + range_ema_fast.size());
         merge(range_ema_slow.begin(),
               range_ema_slow.end(),
@@ -363,10 +319,12 @@ void INITIALIZE_DATA(vector<KLINEf> &PAIRS)
               merged.begin());
         sort(merged.begin(), merged.end());
         merged.erase(unique(merged.begin(), merged.end()), merged.end());
+        vector<INDICATOR_SPEC> ema_specs;
         for (const int ema_per : merged)
         {
-            EMA_LISTS[ic]["EMA_" + std::to_string(ema_per)] = TALIB_EMA(PAIRS[ic].close, ema_per);
+            ema_specs.push_back({IND_EMA, ema_per});
         }
+        INDICATORS[ic].resolve(PAIRS[ic], ema_specs);
         // std::cout << "Calculated EMAs." << endl;
     }
 
@@ -375,7 +333,7 @@ void INITIALIZE_DATA(vector<KLINEf> &PAIRS)
 
 //////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
-int main()
+int main(int argc, char **argv)
 {
     const double t_begin = get_wall_time();
     std::cout << "\n-------------------------------------" << endl;
@@ -386,6 +344,10 @@ int main()
         std::cout << dataf << endl;
     }
 
+    const DATA_MODE data_mode = parse_data_mode(argc, argv);
+    if (run_data_command(data_mode, DATAFILES))
+        return 0;
+
     TA_RetCode retCode;
     retCode = TA_Initialize();
     if (retCode != TA_SUCCESS)
@@ -398,29 +360,26 @@ int main()
         std::cout << "Initialized TA-Lib !\n";
     }
 
-    vector<KLINEf> PAIRS;
-    PAIRS.reserve(NB_PAIRS);
-    for (const string &dataf : DATAFILES)
-    {
-        PAIRS.push_back(read_input_data(dataf));
-    }
+    vector<KLINEf> PAIRS = read_kline_files_parallel(DATAFILES, KLINE_TIMESTAMP | KLINE_HIGH | KLINE_LOW | KLINE_CLOSE);
+    reconcile_last_times(PAIRS, false);
 
     random_shuffle_vector(range_ema_slow);
 
     INITIALIZE_DATA(PAIRS); // this function modifies PAIRS
+    CALENDAR = build_calendar_index(AXIS.timestamp);
 
     best.gain_over_DDC = -100.0f;
     best.calmar_ratio = -100.0f;
 
-    const uint last_idx = PAIRS[0].nb - 1;
+    const uint last_idx = AXIS.nb - 1;
 
-    const int year = get_year_from_timestamp(PAIRS[0].timestamp[0]);
-    const int month = get_month_from_timestamp(PAIRS[0].timestamp[0]);
-    const int day = get_day_from_timestamp(PAIRS[0].timestamp[0]);
+    const int year = get_year_from_timestamp(AXIS.timestamp[0]);
+    const int month = get_month_from_timestamp(AXIS.timestamp[0]);
+    const int day = get_day_from_timestamp(AXIS.timestamp[0]);
 
-    const int last_year = get_year_from_timestamp(PAIRS[0].timestamp[last_idx]);
-    const int last_month = get_month_from_timestamp(PAIRS[0].timestamp[last_idx]);
-    const int last_day = get_day_from_timestamp(PAIRS[0].timestamp[last_idx]);
+    const int last_year = get_year_from_timestamp(AXIS.timestamp[last_idx]);
+    const int last_month = get_month_from_timestamp(AXIS.timestamp[last_idx]);
+    const int last_day = get_day_from_timestamp(AXIS.timestamp[last_idx]);
 
     // Display info
     std::cout << "Begin day      : " << year << "/" << month << "/" << day << endl;
@@ -435,7 +394,7 @@ int main()
     // MAIN LOOP
 
     std::vector<SR_params> param_list{};
-    param_list.reserve(range_ema_slow.size() * range_ema_fast.size() * MAX_OPEN_TRADES_TO_TEST.size());
+    param_list.reserve(nb_combinations());
 
     for (const uint MAX_OPEN_TRADES : MAX_OPEN_TRADES_TO_TEST)
     {
@@ -443,8 +402,14 @@ int main()
         {
             for (const int ema_f : range_ema_fast)
             {
-                SR_params to_add{ema_f, ema_s, MAX_OPEN_TRADES};
-                param_list.push_back(to_add);
+                for (const int atr_window : range_SuperTrend_window)
+                {
+                    for (const float atr_multi : range_SuperTrend_multiplier)
+                    {
+                        SR_params to_add{ema_f, ema_s, atr_window, atr_multi, MAX_OPEN_TRADES};
+                        param_list.push_back(to_add);
+                    }
+                }
             }
         }
     }
@@ -455,7 +420,7 @@ int main()
 
     for (const SR_params par : param_list)
     {
-        const RUN_RESULTf res = PROCESS(PAIRS, par.ema_fast, par.ema_slow, par.max_open_trades);
+        const RUN_RESULTf res = PROCESS(PAIRS, par.ema_fast, par.ema_slow, par.atr_window, par.atr_multi, par.max_open_trades);
 
         if (res.calmar_ratio > best.calmar_ratio && res.gain_pc < 1000000.0f && res.nb_posi_entered >= MIN_NUMBER_OF_TRADES && res.max_DD > MIN_ALLOWED_MAX_DRAWBACK)
         {
@@ -25,6 +25,7 @@ const string timeframe_1 = "1h";
 const string timeframe_2 = "15m";
 vector<string> DATAFILES_1h{};
 vector<string> DATAFILES_15m{};
+DATA_MODE data_mode = DATA_READ;
 
 const float start_year = 2017; // forced year to start (applies if data below is available)
 const float FEE = 0.07f;       // FEES in %
@@ -33,6 +34,8 @@ const uint MIN_NUMBER_OF_TRADES = 100;         // minimum number of trades requi
 const float MIN_ALLOWED_MAX_DRAWBACK = -36.0f; // %
 vector<KLINEf> PAIRS;
 uint start_indexes[NB_PAIRS];
+TIME_AXIS AXIS;          // shared timeline of the 15m PAIRS (see align_pairs)
+CALENDAR_INDEX CALENDAR; // calendar of AXIS
 
 // RANGE OF EMA PERIDOS TO TESTs
 const int period_max = 600;
@@ -40,9 +43,10 @@ const int period_max = 600;
 // vector<int> range_EMA = {180};
 vector<int> range_ema_fast = integer_range(2, 200 + 4, 2);
 vector<int> range_ema_slow = integer_range(70, period_max + 4, 3);
+const int SuperTrend_window = 15; // the 1h SuperTrend is resampled once, so it is not swept
+const float SuperTrend_multiplier = 5.0f;
 //////////////////////////
 
-uint last_times[NB_PAIRS];
 
 uint i_print = 0;
 uint nb_tested = 0;
@@ -91,10 +95,10 @@ RUN_RESULTf PROCESS(vector<KLINEf> &PAIRS, const int ema_f, const int ema_s, con
 
     vector<float> USDT_tracking{};
     USDT_tracking.reserve(1000);
-    vector<int> USDT_tracking_ts{};
-    USDT_tracking_ts.reserve(1000);
+    vector<uint> USDT_tracking_bars{};
+    USDT_tracking_bars.reserve(1000);
 
-    const uint nb_max = PAIRS[0].nb;
+    const uint nb_max = AXIS.nb;
 
     bool LAST_ITERATION = false;
     bool OPEN_LONG_CONDI = false;
@@ -118,9 +122,39 @@ RUN_RESULTf PROCESS(vector<KLINEf> &PAIRS, const int ema_f, const int ema_s, con
     }
     uint ACTIVE_POSITIONS = 0;
 
-    const uint ii_begin = start_indexes[0];
+    // 1h indicators of this run, looked up once: the bar loop only reads spans
+    array<const float *, NB_PAIRS> EMA_FAST, EMA_SLOW, SUPERTREND;
+    for (uint ic = 0; ic < NB_PAIRS; ic++)
+    {
+        EMA_FAST[ic] = PAIRS[ic].indicators.at("EMA_" + std::to_string(ema_f) + "_1h").data();
+        EMA_SLOW[ic] = PAIRS[ic].indicators.at("EMA_" + std::to_string(ema_s) + "_1h").data();
+        SUPERTREND[ic] = PAIRS[ic].indicators.at("supertrend_1h").data();
+    }
+
+    // the conditions only depend on prices and indicators: they are computed for the whole run, then the loop visits the
+    // bars where a position can open or close
+    PAIR_SIGNALS SIGNALS(NB_PAIRS, nb_max);
+    for (uint ic = 0; ic < NB_PAIRS; ic++)
+    {
+        const float *close = PAIRS[ic].close.data();
+        const float *low = PAIRS[ic].low.data();
+        const float *high = PAIRS[ic].high.data();
+        const float *ema_fast = EMA_FAST[ic];
+        const float *ema_slow = EMA_SLOW[ic];
+        const float *supertrend = SUPERTREND[ic];
+        SIGNALS.set_pair(
+            AXIS, ic, start_indexes[ic],
+            [=](const uint jj)
+            { return (ema_fast[jj] > ema_slow[jj]) & (supertrend[jj] == 1) & (close[jj] > ema_fast[jj]) & (low[jj] < ema_fast[jj]); },
+            [=](const uint jj)
+            { return ((ema_fast[jj] < ema_slow[jj]) | (supertrend[jj] == -1)) & (close[jj] < ema_fast[jj]) & (high[jj] > ema_fast[jj]); });
+    }
+    const auto next_bar = [&](const uint ii)
+    { return SIGNALS.next_event(ii, COIN_AMOUNTS.data(), ACTIVE_POSITIONS < MAX_OPEN_TRADES); };
+
+    const uint ii_begin = *std::min_element(start_indexes, start_indexes + NB_PAIRS);
 
-    for (uint ii = ii_begin; ii < nb_max; ii++)
+    for (uint ii = next_bar(ii_begin); ii < nb_max; ii = next_bar(ii + 1))
     {
         if (ii == nb_max - 1)
             LAST_ITERATION = true;
@@ -129,27 +163,20 @@ RUN_RESULTf PROCESS(vector<KLINEf> &PAIRS, const int ema_f, const int ema_s, con
         // For all pairs, check to close / open positions
         for (uint ic = 0; ic < NB_PAIRS; ic++)
         {
-            if (ii < start_indexes[ic])
+            if (ii < start_indexes[ic] || AXIS.is_gap(ic, ii))
                 continue;
+            const uint jj = AXIS.local(ic, ii); // bar ii of the axis in the pair's own data
 
             // conditions for open / close position
-            const std::string ema_f_str = "EMA_" + std::to_string(ema_f) + "_1h";
-            const std::string ema_s_str = "EMA_" + std::to_string(ema_s) + "_1h";
-            OPEN_LONG_CONDI = PAIRS[ic].indicators[ema_f_str][ii] > PAIRS[ic].indicators[ema_s_str][ii] 
-                                && PAIRS[ic].indicators["supertrend_1h"][ii] == 1 
-                                && PAIRS[ic].close[ii] > PAIRS[ic].indicators[ema_f_str][ii] 
-                                && PAIRS[ic].low[ii] < PAIRS[ic].indicators[ema_f_str][ii];
-
-            CLOSE_LONG_CONDI = (PAIRS[ic].indicators[ema_f_str][ii] < PAIRS[ic].indicators[ema_s_str][ii] || PAIRS[ic].indicators["supertrend_1h"][ii] == -1) 
-                                && PAIRS[ic].close[ii] < PAIRS[ic].indicators[ema_f_str][ii] 
-                                && PAIRS[ic].high[ii] > PAIRS[ic].indicators[ema_f_str][ii];
+            OPEN_LONG_CONDI = SIGNALS.open(ic, ii);
+            CLOSE_LONG_CONDI = SIGNALS.close(ic, ii);
 
             // IT IS IMPORTANT TO CHECK FIRST FOR CLOSING POSITION AND ONLY THEN FOR OPENING POSITION
 
             // CLOSE LONG
             if (COIN_AMOUNTS[ic] > 0.0f && (CLOSE_LONG_CONDI || LAST_ITERATION))
             {
-                const float to_add = COIN_AMOUNTS[ic] * PAIRS[ic].close[ii];
+                const float to_add = COIN_AMOUNTS[ic] * PAIRS[ic].close[jj];
                 USDT_amount += to_add;
                 COIN_AMOUNTS[ic] = 0.0f;
 
@@ -160,7 +187,7 @@ RUN_RESULTf PROCESS(vector<KLINEf> &PAIRS, const int ema_f, const int ema_s, con
                 USDT_amount -= fe;
                 total_fees_paid_USDT += fe;
                 //
-                if (PAIRS[ic].close[ii] >= price_position_open[ic])
+                if (PAIRS[ic].close[jj] >= price_position_open[ic])
                 {
                     nb_profit++;
                 }
@@ -174,17 +201,17 @@ RUN_RESULTf PROCESS(vector<KLINEf> &PAIRS, const int ema_f, const int ema_s, con
             // OPEN LONG
             if (COIN_AMOUNTS[ic] == 0.0f && OPEN_LONG_CONDI && LAST_ITERATION == false && ACTIVE_POSITIONS < MAX_OPEN_TRADES)
             {
-                price_position_open[ic] = PAIRS[ic].close[ii];
+                price_position_open[ic] = PAIRS[ic].close[jj];
 
                 const float usdMultiplier = 1.0f / float(MAX_OPEN_TRADES - ACTIVE_POSITIONS);
 
-                COIN_AMOUNTS[ic] = USDT_amount * usdMultiplier / PAIRS[ic].close[ii];
+                COIN_AMOUNTS[ic] = USDT_amount * usdMultiplier / PAIRS[ic].close[jj];
                 USDT_amount -= USDT_amount * usdMultiplier;
 
                 // apply FEEs
                 const float fe = COIN_AMOUNTS[ic] * FEE / 100.0f;
                 COIN_AMOUNTS[ic] -= fe;
-                total_fees_paid_USDT += fe * PAIRS[ic].close[ii];
+                total_fees_paid_USDT += fe * PAIRS[ic].close[jj];
                 //
 
                 ACTIVE_POSITIONS++;
@@ -197,7 +224,7 @@ RUN_RESULTf PROCESS(vector<KLINEf> &PAIRS, const int ema_f, const int ema_s, con
         {
             array<float, NB_PAIRS> closes{};
             for (uint ic = 0; ic < NB_PAIRS; ic++)
-                closes[ic] = PAIRS[ic].close[ii];
+                closes[ic] = AXIS.listed(ic, ii) ? PAIRS[ic].close[AXIS.local(ic, ii)] : 0.0f;
 
             WALLET_VAL_USDT = USDT_amount + vector_product(COIN_AMOUNTS, closes);
             if (WALLET_VAL_USDT > MAX_WALLET_VAL_USDT)
@@ -208,13 +235,13 @@ RUN_RESULTf PROCESS(vector<KLINEf> &PAIRS, const int ema_f, const int ema_s, con
                 max_drawdown = pc_change_with_max;
 
             USDT_tracking.push_back(WALLET_VAL_USDT);
-            USDT_tracking_ts.push_back(PAIRS[0].timestamp[ii]);
+            USDT_tracking_bars.push_back(ii);
         }
     }
 
     array<float, NB_PAIRS> last_closes{};
     for (uint ic = 0; ic < NB_PAIRS; ic++)
-        last_closes[ic] = PAIRS[ic].close[nb_max - 1];
+        last_closes[ic] = PAIRS[ic].close[PAIRS[ic].nb - 1];
 
     WALLET_VAL_USDT = USDT_amount + vector_product(COIN_AMOUNTS, last_closes);
 
@@ -240,7 +267,7 @@ RUN_RESULTf PROCESS(vector<KLINEf> &PAIRS, const int ema_f, const int ema_s, con
     result.nb_posi_entered = NB_POSI_ENTERED;
     result.win_rate = WR;
     result.score = score;
-    result.calmar_ratio = calculate_calmar_ratio(USDT_tracking_ts, USDT_tracking, DDC);
+    result.calmar_ratio = calculate_calmar_ratio(CALENDAR, USDT_tracking_bars, USDT_tracking, DDC);
     result.ema1 = ema_f;
     result.ema2 = ema_s;
     result.total_fees_paid = total_fees_paid_USDT;
@@ -250,138 +277,22 @@ RUN_RESULTf PROCESS(vector<KLINEf> &PAIRS, const int ema_f, const int ema_s, con
 }
 
 //////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
-int super_index = 0;
-long int previous_ts = 0;
-int nb_read = 0;
-KLINEf read_input_data(const string &input_file_path)
-{
-    KLINEf kline;
-
-    ifstream myfile(input_file_path);
-    string line;
-    long int ts;
-    float op, hi, lo, cl, vol;
-    previous_ts = 0;
-    ifstream file(input_file_path);
-    string value;
-    vector<string> getInform;
-    nb_read=0;
-    while (file.good())
-    {
-        getline(file, value);
-        value = ReplaceAll(value, ";", " ");
-        getInform.push_back(value);
-        // getInform.erase(getInform.begin()+1);
-        stringstream ss{};
-        ss << value;
-        ss >> ts >> op >> hi >> lo >> cl >> vol;
-        kline.timestamp.push_back(ts / 1000);
-        if (previous_ts==ts) {
-            std::cout << "FOUND DUPLICATE TS at index " << nb_read << "; INGNORING. "<< std::endl;
-            previous_ts = ts / 1000;
-            continue;
-        }
-        previous_ts = ts;
-        kline.open.push_back(op);
-        kline.high.push_back(hi);
-        kline.low.push_back(lo);
-        kline.close.push_back(cl);
-        nb_read++;
-    }
-
-    last_times[super_index] = kline.timestamp.back();
-
-    // cout << last_times[super_index] << endl;
-    // cout << super_index << endl;
-
-    if (super_index >= 1)
-    {
-        if (last_times[super_index] != last_times[super_index - 1])
-        {
-            cout << "Error: inconsistent last times between different pairs." << endl;
-            std::abort();
-        }
-    }
-
-    super_index++;
-
-    myfile.close();
-
-    kline.nb = int(kline.close.size());
-
-    std::cout << "Loaded data file." << endl;
-    return kline;
-}
-
-//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
-
-vector<uint> add_zeros(const vector<uint> &vec_in, const int nb_to_add)
-{
-    vector<uint> vec_to_add(nb_to_add, 0);
-    vec_to_add.insert(vec_to_add.end(), vec_in.begin(), vec_in.end());
-    return vec_to_add;
-}
-vector<float> add_zeros(const vector<float> &vec_in, const int nb_to_add)
-{
-    vector<float> vec_to_add(nb_to_add, 0.0);
-    vec_to_add.insert(vec_to_add.end(), vec_in.begin(), vec_in.end());
-    return vec_to_add;
-}
 
 vector<KLINEf> LOAD_LTF_DATA()
 {
     // calculate MTF 1h data from 15 min data
 
-    vector<KLINEf> PAIRS{};
-    PAIRS.reserve(NB_PAIRS);
-
-    for (const string &dataf : DATAFILES_15m)
-    {
-        PAIRS.push_back(read_input_data(dataf));
-    }
-    super_index = 0;
-
-    start_indexes[0] = find_max(range_ema_slow) + 2;
-
-    // find initial indexes (different starting times)
-    for (uint i = 0; i < PAIRS[0].timestamp.size(); i++)
-    {
-        for (uint ic = 1; ic < NB_PAIRS; ic++)
-        {
-            if (PAIRS[ic].timestamp[0] == PAIRS[0].timestamp[i])
-            {
-                start_indexes[ic] = start_indexes[0] + i;
-                std::cout << "Start for 15m " + COINS[ic] << " : " << i << endl;
-            }
-        }
-    }
-
-    for (uint ic = 1; ic < NB_PAIRS; ic++)
-    {
-        const int nb_to_add = PAIRS[0].close.size() - PAIRS[ic].close.size();
-
-        PAIRS[ic].timestamp = add_zeros(PAIRS[ic].timestamp, nb_to_add);
-        PAIRS[ic].open = add_zeros(PAIRS[ic].open, nb_to_add);
-        PAIRS[ic].high = add_zeros(PAIRS[ic].high, nb_to_add);
-        PAIRS[ic].low = add_zeros(PAIRS[ic].low, nb_to_add);
-        PAIRS[ic].close = add_zeros(PAIRS[ic].close, nb_to_add);
+    vector<KLINEf> PAIRS = read_kline_files_parallel(DATAFILES_15m, KLINE_TIMESTAMP | KLINE_HIGH | KLINE_LOW | KLINE_CLOSE);
+    reconcile_last_times(PAIRS, false);
 
-        PAIRS[ic].nb = PAIRS[0].close.size();
-
-        for (uint ii = 0; ii < start_indexes[ic] + 5; ii++)
-        {
-            PAIRS[ic].timestamp[ii] = PAIRS[0].timestamp[ii];
-        }
-    }
+    // pairs trade once the indicators are warmed up on their own data
+    const uint warmup = find_max(range_ema_slow) + 2;
 
-    for (uint ic = 1; ic < NB_PAIRS; ic++)
+    AXIS = align_pairs(PAIRS);
+    for (uint ic = 0; ic < NB_PAIRS; ic++)
     {
-        if (PAIRS[ic].nb != PAIRS[0].nb || PAIRS[ic].open.size() != PAIRS[0].open.size())
-        {
-            std::cout << "ERROR: incosistent size" << endl;
-            std::cout << PAIRS[ic].nb << " " << PAIRS[0].nb << " " << PAIRS[ic].open.size() << " " << PAIRS[0].open.size() << std::endl;
-            abort();
-        }
+        start_indexes[ic] = warmup + AXIS.first[ic];
+        std::cout << "Start for 15m " + COINS[ic] << " : " << AXIS.first[ic] << endl;
     }
 
     return PAIRS;
@@ -393,54 +304,11 @@ vector<KLINEf> LOAD_H1_DATA()
 {
     // calculation indicators in the 1h timeframe
 
-    vector<KLINEf> PAIRS_1h{};
-    uint start_indexes_1h[NB_PAIRS];
+    vector<KLINEf> PAIRS_1h = read_kline_files_parallel(DATAFILES_1h, KLINE_TIMESTAMP | KLINE_HIGH | KLINE_LOW | KLINE_CLOSE);
+    reconcile_last_times(PAIRS_1h, false);
 
-    for (const string &dataf : DATAFILES_1h)
-    {
-        PAIRS_1h.push_back(read_input_data(dataf));
-    }
-    start_indexes_1h[0] = find_max(range_ema_slow) + 2;
-
-    // find initial indexes (different starting times)
-    for (uint i = 0; i < PAIRS_1h[0].timestamp.size(); i++)
-    {
-        for (uint ic = 1; ic < NB_PAIRS; ic++)
-        {
-            if (PAIRS_1h[ic].timestamp[0] == PAIRS_1h[0].timestamp[i])
-            {
-                start_indexes_1h[ic] = start_indexes_1h[0] + i;
-                std::cout << "Start for 1h " + COINS[ic] << " : " << i << endl;
-            }
-        }
-    }
-
-    for (uint ic = 1; ic < NB_PAIRS; ic++)
-    {
-        const int nb_to_add = PAIRS_1h[0].close.size() - PAIRS_1h[ic].close.size();
-
-        PAIRS_1h[ic].timestamp = add_zeros(PAIRS_1h[ic].timestamp, nb_to_add);
-        PAIRS_1h[ic].open = add_zeros(PAIRS_1h[ic].open, nb_to_add);
-        PAIRS_1h[ic].high = add_zeros(PAIRS_1h[ic].high, nb_to_add);
-        PAIRS_1h[ic].low = add_zeros(PAIRS_1h[ic].low, nb_to_add);
-        PAIRS_1h[ic].close = add_zeros(PAIRS_1h[ic].close, nb_to_add);
-
-        PAIRS_1h[ic].nb = PAIRS_1h[0].close.size();
-
-        for (uint ii = 0; ii < start_indexes_1h[ic] + 5; ii++)
-        {
-            PAIRS_1h[ic].timestamp[ii] = PAIRS_1h[0].timestamp[ii];
-        }
-    }
-
-    for (uint ic = 1; ic < NB_PAIRS; ic++)
-    {
-        if (PAIRS_1h[ic].nb != PAIRS_1h[0].nb || PAIRS_1h[ic].open.size() != PAIRS_1h[0].open.size())
-        {
-            std::cout << "ERROR: incosistent size" << endl;
-            abort();
-        }
-    }
+    // only fills the trading halts: the 1h bars are mapped onto the 15m ones by timestamp (see RESAMPLE_TIMEFRAME)
+    align_pairs(PAIRS_1h);
 
     //
     for (uint ic = 0; ic < NB_PAIRS; ic++)
@@ -448,7 +316,7 @@ vector<KLINEf> LOAD_H1_DATA()
         std::cout << "Calculating for " << COINS[ic] << endl;
 
         // std::cout << "Calculated STOCHRSI." << endl;
-        PAIRS_1h[ic].indicators["supertrend"] = TALIB_SuperTrend_dir_only(PAIRS_1h[ic].high, PAIRS_1h[ic].low, PAIRS_1h[ic].close, 15, 5);
+        PAIRS_1h[ic].indicators["supertrend"] = TALIB_SuperTrend_dir_only(PAIRS_1h[ic].high, PAIRS_1h[ic].low, PAIRS_1h[ic].close, SuperTrend_window, SuperTrend_multiplier);
 
         // Calculate EMAs
         vector<int> merged(range_ema_slow.size() + range_ema_fast.size());
@@ -489,7 +357,7 @@ void INITIALIZE_DATA()
 
 //////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
-int main()
+int main(int argc, char **argv)
 {
     const double t_begin = get_wall_time();
     std::cout << "\n-------------------------------------" << endl;
@@ -507,6 +375,12 @@ int main()
         std::cout << dataf << endl;
     }
 
+    data_mode = parse_data_mode(argc, argv);
+    vector<string> all_datafiles = DATAFILES_15m;
+    all_datafiles.insert(all_datafiles.end(), DATAFILES_1h.begin(), DATAFILES_1h.end());
+    if (run_data_command(data_mode, all_datafiles))
+        return 0;
+
     TA_RetCode retCode;
     retCode = TA_Initialize();
     if (retCode != TA_SUCCESS)
@@ -520,19 +394,20 @@ int main()
     }
 
     INITIALIZE_DATA();
+    CALENDAR = build_calendar_index(AXIS.timestamp);
 
     best.gain_over_DDC = -100.0f;
     best.calmar_ratio = -100.0f;
 
-    const uint last_idx = PAIRS[0].nb - 1;
+    const uint last_idx = AXIS.nb - 1;
 
-    const int year = get_year_from_timestamp(PAIRS[0].timestamp[0]);
-    const int month = get_month_from_timestamp(PAIRS[0].timestamp[0]);
-    const int day = get_day_from_timestamp(PAIRS[0].timestamp[0]);
+    const int year = get_year_from_timestamp(AXIS.timestamp[0]);
+    const int month = get_month_from_timestamp(AXIS.timestamp[0]);
+    const int day = get_day_from_timestamp(AXIS.timestamp[0]);
 
-    const int last_year = get_year_from_timestamp(PAIRS[0].timestamp[last_idx]);
-    const int last_month = get_month_from_timestamp(PAIRS[0].timestamp[last_idx]);
-    const int last_day = get_day_from_timestamp(PAIRS[0].timestamp[last_idx]);
+    const int last_year = get_year_from_timestamp(AXIS.timestamp[last_idx]);
+    const int last_month = get_month_from_timestamp(AXIS.timestamp[last_idx]);
+    const int last_day = get_day_from_timestamp(AXIS.timestamp[last_idx]);
 
     // Display info
     std::cout << "Begin day      : " << year << "/" << month << "/" << day << endl;
@@ -557,7 +432,7 @@ int main()
         {
             for (const int ema_f : range_ema_fast)
             {
-                SR_params to_add{ema_f, ema_s, MAX_OPEN_TRADES};
+                SR_params to_add{ema_f, ema_s, SuperTrend_window, SuperTrend_multiplier, MAX_OPEN_TRADES};
                 param_list.push_back(to_add);
             }
         }
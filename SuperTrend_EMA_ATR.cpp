@@ -37,16 +37,19 @@ const float USDT_amount_initial = 1000.0f;
 const uint MIN_NUMBER_OF_TRADES = 100;         // minimum number of trades required (to avoid some noise / lucky circunstances)
 const float MIN_ALLOWED_MAX_DRAWBACK = -40.0f; // %
 uint start_indexes[NB_PAIRS];
+TIME_AXIS AXIS;          // shared timeline of PAIRS (see align_pairs)
+CALENDAR_INDEX CALENDAR; // calendar of AXIS
 
 // RANGE OF EMA PERIDOS TO TESTs
 const int period_max_EMA = 600;
 // const int range_step = 2;
 // vector<int> range_EMA = {180};
 vector<int> range_EMA = integer_range(40, period_max_EMA + 2, 1);
+const vector<int> range_SuperTrend_window = {10};
+const vector<float> range_SuperTrend_multiplier = {3.0f};
 //////////////////////////
-array<std::unordered_map<string, vector<float>>, NB_PAIRS> EMA_LISTS{};
+array<INDICATOR_REGISTRY, NB_PAIRS> INDICATORS{};
 array<vector<float>, NB_PAIRS> ATR_LISTS{};
-array<SuperTrend, NB_PAIRS> SuperTrend_LISTS{};
 
 uint i_print = 0;
 uint nb_tested = 0;
@@ -62,6 +65,7 @@ void print_best_res(const RUN_RESULTf &bestt)
     std::cout << "-------------------------------------" << endl;
     std::cout << "Strategy : " << STRAT_NAME << endl;
     std::cout << "EMA : " << bestt.ema1 << endl;
+    std::cout << "SuperTrend ATR window - multiplier : " << bestt.atr_window << " - " << bestt.atr_multi << endl;
     std::cout << "Max Open Trades : " << bestt.max_open_trades << endl;
     std::cout << "Best Gain: " << bestt.gain_pc << "%" << endl;
     std::cout << "Porfolio : " << bestt.WALLET_VAL_USDT << "$ (started with 1000$)" << endl;
@@ -78,16 +82,16 @@ void print_best_res(const RUN_RESULTf &bestt)
 
 //////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
-RUN_RESULTf PROCESS(const vector<KLINEf> &PAIRS, const int ema_v, const uint NB_POSITION_MAX)
+RUN_RESULTf PROCESS(const vector<KLINEf> &PAIRS, const int ema_v, const int atr_window, const float atr_multi, const uint NB_POSITION_MAX)
 {
     nb_tested++;
 
     RUN_RESULTf result{};
 
     vector<float> USDT_tracking{};
-    vector<int> USDT_tracking_ts{};
+    vector<uint> USDT_tracking_bars{};
 
-    const uint nb_max = PAIRS[0].nb;
+    const uint nb_max = AXIS.nb;
 
     bool LAST_ITERATION = false;
     bool OPEN_LONG_CONDI = false;
@@ -113,9 +117,37 @@ RUN_RESULTf PROCESS(const vector<KLINEf> &PAIRS, const int ema_v, const uint NB_
     }
     uint ACTIVE_POSITIONS = 0;
 
-    const uint ii_begin = start_indexes[0];
+    // EMAs and SuperTrend directions of this run, resolved once: the bar loop only reads spans
+    array<const float *, NB_PAIRS> EMA, SUPERTREND;
+    for (uint ic = 0; ic < NB_PAIRS; ic++)
+    {
+        EMA[ic] = INDICATORS[ic].span(PAIRS[ic], {IND_EMA, ema_v});
+        SUPERTREND[ic] = INDICATORS[ic].span(PAIRS[ic], supertrend_dir_spec(atr_window, atr_multi));
+    }
+
+    // the conditions apart from the take profit and the trailing stop loss only depend on prices and indicators: they are
+    // computed for the whole run. The loop visits every bar while a position is open, and only the bars with an open
+    // signal otherwise
+    PAIR_SIGNALS SIGNALS(NB_PAIRS, nb_max);
+    for (uint ic = 0; ic < NB_PAIRS; ic++)
+    {
+        const float *close = PAIRS[ic].close.data();
+        const float *low = PAIRS[ic].low.data();
+        const float *ema = EMA[ic];
+        const float *supertrend = SUPERTREND[ic];
+        SIGNALS.set_pair(
+            AXIS, ic, start_indexes[ic],
+            [=](const uint jj)
+            { return (close[jj] > ema[jj]) & (supertrend[jj] > 0.0f); },
+            [=](const uint jj)
+            { return (low[jj] < ema[jj]) | (supertrend[jj] < 0.0f); });
+    }
+    const auto next_bar = [&](const uint ii)
+    { return ACTIVE_POSITIONS > 0 ? ii : SIGNALS.next_event(ii, COIN_AMOUNTS.data(), true); };
+
+    const uint ii_begin = *std::min_element(start_indexes, start_indexes + NB_PAIRS);
 
-    for (uint ii = ii_begin; ii < nb_max; ii++)
+    for (uint ii = next_bar(ii_begin); ii < nb_max; ii = next_bar(ii + 1))
     {
         if (ii == nb_max - 1)
             LAST_ITERATION = true;
@@ -124,12 +156,13 @@ RUN_RESULTf PROCESS(const vector<KLINEf> &PAIRS, const int ema_v, const uint NB_
         // For all pairs, check to close / open positions
         for (uint ic = 0; ic < NB_PAIRS; ic++)
         {
-            if (ii < start_indexes[ic])
+            if (ii < start_indexes[ic] || AXIS.is_gap(ic, ii))
                 continue;
+            const uint jj = AXIS.local(ic, ii); // bar ii of the axis in the pair's own data
 
             if (COIN_AMOUNTS[ic] > 0.0f)
             {
-                const float delta = PAIRS[ic].close[ii] - price_position_open[ic];
+                const float delta = PAIRS[ic].close[jj] - price_position_open[ic];
                 if (delta > TSL_max_price_increase[ic])
                 {
                     TSL_max_price_increase[ic] = delta;
@@ -139,15 +172,15 @@ RUN_RESULTf PROCESS(const vector<KLINEf> &PAIRS, const int ema_v, const uint NB_
 
             // conditions for open / close position
 
-            OPEN_LONG_CONDI = PAIRS[ic].close[ii] > EMA_LISTS[ic]["EMA_" + std::to_string(ema_v)][ii] && SuperTrend_LISTS[ic].supertrend[ii] == 1;
-            CLOSE_LONG_CONDI = PAIRS[ic].low[ii] < EMA_LISTS[ic]["EMA_" + std::to_string(ema_v)][ii] || SuperTrend_LISTS[ic].supertrend[ii] == -1 || PAIRS[ic].close[ii] > take_profit[ic] || PAIRS[ic].high[ii] < stop_loss[ic];
+            OPEN_LONG_CONDI = SIGNALS.open(ic, ii);
+            CLOSE_LONG_CONDI = SIGNALS.close(ic, ii) || PAIRS[ic].close[jj] > take_profit[ic] || PAIRS[ic].high[jj] < stop_loss[ic];
 
             // IT IS IMPORTANT TO CHECK FIRST FOR CLOSING POSITION AND ONLY THEN FOR OPENING POSITION
 
             // CLOSE LONG
             if (COIN_AMOUNTS[ic] > 0.0f && (CLOSE_LONG_CONDI || LAST_ITERATION))
             {
-                const float to_add = COIN_AMOUNTS[ic] * PAIRS[ic].close[ii];
+                const float to_add = COIN_AMOUNTS[ic] * PAIRS[ic].close[jj];
                 USDT_amount += to_add;
                 COIN_AMOUNTS[ic] = 0.0f;
                 TSL_max_price_increase[ic] = 0.0f;
@@ -159,7 +192,7 @@ RUN_RESULTf PROCESS(const vector<KLINEf> &PAIRS, const int ema_v, const uint NB_
                 USDT_amount -= fe;
                 total_fees_paid_USDT += fe;
                 //
-                if (PAIRS[ic].close[ii] >= price_position_open[ic])
+                if (PAIRS[ic].close[jj] >= price_position_open[ic])
                 {
                     nb_profit++;
                 }
@@ -173,21 +206,21 @@ RUN_RESULTf PROCESS(const vector<KLINEf> &PAIRS, const int ema_v, const uint NB_
             // OPEN LONG
             if (COIN_AMOUNTS[ic] == 0.0f && OPEN_LONG_CONDI && LAST_ITERATION == false && ACTIVE_POSITIONS < NB_POSITION_MAX)
             {
-                price_position_open[ic] = PAIRS[ic].close[ii];
+                price_position_open[ic] = PAIRS[ic].close[jj];
 
                 const float usdMultiplier = 1.0f / float(NB_POSITION_MAX - ACTIVE_POSITIONS);
 
-                COIN_AMOUNTS[ic] = USDT_amount * usdMultiplier / PAIRS[ic].close[ii];
+                COIN_AMOUNTS[ic] = USDT_amount * usdMultiplier / PAIRS[ic].close[jj];
                 USDT_amount -= USDT_amount * usdMultiplier;
 
                 // apply FEEs
                 const float fe = COIN_AMOUNTS[ic] * FEE / 100.0f;
                 COIN_AMOUNTS[ic] -= fe;
-                total_fees_paid_USDT += fe * PAIRS[ic].close[ii];
+                total_fees_paid_USDT += fe * PAIRS[ic].close[jj];
                 //
-                stop_loss[ic] = PAIRS[ic].close[ii] - ATR_LISTS[ic][ii] * 3.0;
+                stop_loss[ic] = PAIRS[ic].close[jj] - ATR_LISTS[ic][jj] * 3.0;
                 stop_loss_at_open[ic] = stop_loss[ic];
-                take_profit[ic] = PAIRS[ic].close[ii] + ATR_LISTS[ic][ii] * 9.0;
+                take_profit[ic] = PAIRS[ic].close[jj] + ATR_LISTS[ic][jj] * 9.0;
 
                 ACTIVE_POSITIONS++;
                 NB_POSI_ENTERED++;
@@ -199,7 +232,7 @@ RUN_RESULTf PROCESS(const vector<KLINEf> &PAIRS, const int ema_v, const uint NB_
         {
             array<float, NB_PAIRS> closes{};
             for (uint ic = 0; ic < NB_PAIRS; ic++)
-                closes[ic] = PAIRS[ic].close[ii];
+                closes[ic] = AXIS.listed(ic, ii) ? PAIRS[ic].close[AXIS.local(ic, ii)] : 0.0f;
 
             WALLET_VAL_USDT = USDT_amount + vector_product(COIN_AMOUNTS, closes);
             if (WALLET_VAL_USDT > MAX_WALLET_VAL_USDT)
@@ -210,13 +243,13 @@ RUN_RESULTf PROCESS(const vector<KLINEf> &PAIRS, const int ema_v, const uint NB_
                 max_drawdown = pc_change_with_max;
 
             USDT_tracking.push_back(WALLET_VAL_USDT);
-            USDT_tracking_ts.push_back(PAIRS[0].timestamp[ii]);
+            USDT_tracking_bars.push_back(ii);
         }
     }
 
     array<float, NB_PAIRS> last_closes{};
     for (uint ic = 0; ic < NB_PAIRS; ic++)
-        last_closes[ic] = PAIRS[ic].close[nb_max - 1];
+        last_closes[ic] = PAIRS[ic].close[PAIRS[ic].nb - 1];
 
     WALLET_VAL_USDT = USDT_amount + vector_product(COIN_AMOUNTS, last_closes);
 
@@ -240,108 +273,31 @@ RUN_RESULTf PROCESS(const vector<KLINEf> &PAIRS, const int ema_v, const uint NB_
     result.nb_posi_entered = NB_POSI_ENTERED;
     result.win_rate = WR;
     result.score = score;
-    result.calmar_ratio = calculate_calmar_ratio(USDT_tracking_ts, USDT_tracking, DDC);
+    result.calmar_ratio = calculate_calmar_ratio(CALENDAR, USDT_tracking_bars, USDT_tracking, DDC);
     result.ema1 = ema_v;
+    result.atr_window = atr_window;
+    result.atr_multi = atr_multi;
     result.total_fees_paid = total_fees_paid_USDT;
     result.max_open_trades = NB_POSITION_MAX;
 
     return result;
 }
 
-//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
-int super_index = 0;
-long int previous_ts = 0;
-int nb_read = 0;
-KLINEf read_input_data(const string &input_file_path)
-{
-    KLINEf kline;
-
-    ifstream myfile(input_file_path);
-    string line;
-    long int ts;
-    float op, hi, lo, cl, vol;
-    previous_ts = 0;
-    ifstream file(input_file_path);
-    string value;
-    vector<string> getInform;
-    nb_read=0;
-    while (file.good())
-    {
-        getline(file, value);
-        value = ReplaceAll(value, ";", " ");
-        getInform.push_back(value);
-        // getInform.erase(getInform.begin()+1);
-        stringstream ss{};
-        ss << value;
-        ss >> ts >> op >> hi >> lo >> cl >> vol;
-        kline.timestamp.push_back(ts / 1000);
-        if (previous_ts==ts) {
-            std::cout << "FOUND DUPLICATE TS at index " << nb_read << "; INGNORING. "<< std::endl;
-            previous_ts = ts / 1000;
-            continue;
-        }
-        previous_ts = ts;
-        kline.open.push_back(op);
-        kline.high.push_back(hi);
-        kline.low.push_back(lo);
-        kline.close.push_back(cl);
-        nb_read++;
-    }
-
-    myfile.close();
-
-    kline.nb = int(kline.close.size());
-
-    std::cout << "Loaded data file." << endl;
-    return kline;
-}
-
 //////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 void INITIALIZE_DATA(vector<KLINEf> &PAIRS)
 // will modify PAIRS since it is passed as reference
 {
     std::cout << "Running INITIALIZE_DATA..." << endl;
 
-    start_indexes[0] = find_max(range_EMA) + 2;
-
-    // find initial indexes (different starting times)
-    for (uint i = 0; i < PAIRS[0].timestamp.size(); i++)
-    {
-        for (uint ic = 1; ic < NB_PAIRS; ic++)
-        {
-            if (PAIRS[ic].timestamp[0] == PAIRS[0].timestamp[i])
-            {
-                start_indexes[ic] = start_indexes[0] + i;
-                std::cout << "Start for " + COINS[ic] << " : " << i << endl;
-            }
-        }
-    }
-
-    for (uint ic = 1; ic < NB_PAIRS; ic++)
-    {
-        while (PAIRS[ic].close.size() < PAIRS[0].close.size())
-        {
-            PAIRS[ic].timestamp.insert(PAIRS[ic].timestamp.begin(), 0);
-            PAIRS[ic].open.insert(PAIRS[ic].open.begin(), 0.0f);
-            PAIRS[ic].high.insert(PAIRS[ic].high.begin(), 0.0f);
-            PAIRS[ic].low.insert(PAIRS[ic].low.begin(), 0.0f);
-            PAIRS[ic].close.insert(PAIRS[ic].close.begin(), 0.0f);
-            PAIRS[ic].nb++;
-        }
-
-        for (uint ii = 0; ii < start_indexes[ic] + 5; ii++)
-        {
-            PAIRS[ic].timestamp[ii] = PAIRS[0].timestamp[ii];
-        }
-    }
+    // pairs trade once the indicators are warmed up on their own data
+    const uint warmup = find_max(range_EMA) + 2;
 
-    for (uint ic = 1; ic < NB_PAIRS; ic++)
+    AXIS = align_pairs(PAIRS);
+    for (uint ic = 0; ic < NB_PAIRS; ic++)
     {
-        if (PAIRS[ic].nb != PAIRS[0].nb || PAIRS[ic].open.size() != PAIRS[0].open.size())
-        {
-            std::cout << "ERROR: incosistent size" << endl;
-            abort();
-        }
+        start_indexes[ic] = warmup + AXIS.first[ic];
+        std::cout << "Start for " + COINS[ic] << " : " << AXIS.first[ic] << endl;
+        INDICATORS[ic].store_in(INDICATOR_STORE_DIR, PAIRS[ic]);
     }
 
     //
@@ -352,12 +308,23 @@ void INITIALIZE_DATA(vector<KLINEf> &PAIRS)
         // StochRSI = TALIB_STOCHRSI_K(kline.d_close,14,3,3);
         ATR_LISTS[ic] = TALIB_ATR(PAIRS[ic].high, PAIRS[ic].low, PAIRS[ic].close, 17);
         // std::cout << "Calculated STOCHRSI." << endl;
-        SuperTrend_LISTS[ic] = TALIB_SuperTrend(PAIRS[ic].high, PAIRS[ic].low, PAIRS[ic].close, 10, 3);
+        // the whole SuperTrend grid shares one true range pass and one ATR per window
+        vector<INDICATOR_SPEC> supertrend_specs;
+        for (const int window : range_SuperTrend_window)
+        {
+            for (const float multiplier : range_SuperTrend_multiplier)
+            {
+                supertrend_specs.push_back(supertrend_dir_spec(window, multiplier));
+            }
+        }
+        INDICATORS[ic].resolve(PAIRS[ic], supertrend_specs);
 
-        for (const uint ema_per : range_EMA)
+        vector<INDICATOR_SPEC> ema_specs;
+        for (const int ema_per : range_EMA)
         {
-            EMA_LISTS[ic]["EMA_" + std::to_string(ema_per)] = TALIB_EMA(PAIRS[ic].close, ema_per);
+            ema_specs.push_back({IND_EMA, ema_per});
         }
+        INDICATORS[ic].resolve(PAIRS[ic], ema_specs);
         // std::cout << "Calculated EMAs." << endl;
     }
 
@@ -366,7 +333,7 @@ void INITIALIZE_DATA(vector<KLINEf> &PAIRS)
 
 //////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
-int main()
+int main(int argc, char **argv)
 {
     const double t_begin = get_wall_time();
     std::cout << "\n-------------------------------------" << endl;
@@ -379,6 +346,10 @@ int main()
 
     random_shuffle_vector(range_EMA);
 
+    const DATA_MODE data_mode = parse_data_mode(argc, argv);
+    if (run_data_command(data_mode, DATAFILES))
+        return 0;
+
     TA_RetCode retCode;
     retCode = TA_Initialize();
     if (retCode != TA_SUCCESS)
@@ -391,27 +362,24 @@ int main()
         std::cout << "Initialized TA-Lib !\n";
     }
 
-    vector<KLINEf> PAIRS;
-    PAIRS.reserve(NB_PAIRS);
-    for (const string &dataf : DATAFILES)
-    {
-        PAIRS.push_back(read_input_data(dataf));
-    }
+    vector<KLINEf> PAIRS = read_kline_files_parallel(DATAFILES, KLINE_TIMESTAMP | KLINE_HIGH | KLINE_LOW | KLINE_CLOSE);
+    reconcile_last_times(PAIRS, true);
 
     INITIALIZE_DATA(PAIRS); // this function modifies PAIRS
+    CALENDAR = build_calendar_index(AXIS.timestamp);
 
     best.gain_over_DDC = -100.0f;
     best.calmar_ratio = -100.0f;
 
-    const uint last_idx = PAIRS[0].nb - 1;
+    const uint last_idx = AXIS.nb - 1;
 
-    const int year = get_year_from_timestamp(PAIRS[0].timestamp[0]);
-    const int month = get_month_from_timestamp(PAIRS[0].timestamp[0]);
-    const int day = get_day_from_timestamp(PAIRS[0].timestamp[0]);
+    const int year = get_year_from_timestamp(AXIS.timestamp[0]);
+    const int month = get_month_from_timestamp(AXIS.timestamp[0]);
+    const int day = get_day_from_timestamp(AXIS.timestamp[0]);
 
-    const int last_year = get_year_from_timestamp(PAIRS[0].timestamp[last_idx]);
-    const int last_month = get_month_from_timestamp(PAIRS[0].timestamp[last_idx]);
-    const int last_day = get_day_from_timestamp(PAIRS[0].timestamp[last_idx]);
+    const int last_year = get_year_from_timestamp(AXIS.timestamp[last_idx]);
+    const int last_month = get_month_from_timestamp(AXIS.timestamp[last_idx]);
+    const int last_day = get_day_from_timestamp(AXIS.timestamp[last_idx]);
 
     // Display info
     std::cout << "Begin day      : " << year << "/" << month << "/" << day << endl;
@@ -428,11 +396,17 @@ int main()
     {
         for (const int ema : range_EMA)
         {
-            const RUN_RESULTf res = PROCESS(PAIRS, ema, MAX_OPEN_TRADES);
-
-            if (res.calmar_ratio > best.calmar_ratio && res.gain_pc < 1000000.0f && res.nb_posi_entered >= MIN_NUMBER_OF_TRADES && res.max_DD > MIN_ALLOWED_MAX_DRAWBACK)
+            for (const int atr_window : range_SuperTrend_window)
             {
-                best = res;
+                for (const float atr_multi : range_SuperTrend_multiplier)
+                {
+                    const RUN_RESULTf res = PROCESS(PAIRS, ema, atr_window, atr_multi, MAX_OPEN_TRADES);
+
+                    if (res.calmar_ratio > best.calmar_ratio && res.gain_pc < 1000000.0f && res.nb_posi_entered >= MIN_NUMBER_OF_TRADES && res.max_DD > MIN_ALLOWED_MAX_DRAWBACK)
+                    {
+                        best = res;
+                    }
+                }
             }
         }
     }
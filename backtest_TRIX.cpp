@@ -29,6 +29,7 @@ const float MIN_ALLOWED_MAX_DRAWBACK = -50.0f; // %
 const float STOCH_RSI_UPPER = 0.800f;
 const float STOCH_RSI_LOWER = 0.200f;
 uint start_indexes[NB_PAIRS];
+TIME_AXIS AXIS; // shared timeline of PAIRS (see align_pairs)
 
 // RANGE OF EMA PERIDOS TO TESTs
 const int period_max_EMA = 500;
@@ -37,9 +38,9 @@ const int period_max_EMA = 500;
 const vector<int> range_EMA = integer_range(100, period_max_EMA + 2, 2);
 const vector<int> range_trixLength = integer_range(4, 17, 1);
 const vector<int> range_trixSignal = integer_range(10, 42, 1);
+const vector<int> range_StochRSI_window = {14};
 //////////////////////////
-array<std::unordered_map<string, vector<float>>, NB_PAIRS> EMA_LISTS{};
-array<vector<float>, NB_PAIRS> StochRSI_LISTS{};
+array<INDICATOR_REGISTRY, NB_PAIRS> INDICATORS{};
 
 uint i_print = 0;
 uint nb_tested = 0;
@@ -68,6 +69,7 @@ void print_best_res(const RUN_RESULTf &bestt)
     std::cout << "-------------------------------------" << endl;
     std::cout << "Strategy : " << STRAT_NAME << endl;
     std::cout << "EMA TRIX_L TRIX_S     : " << bestt.ema1 << " " << bestt.trixLength << " " << bestt.trixSignal << endl;
+    std::cout << "StochRSI window       : " << bestt.stoch_window << endl;
     std::cout << "Best Gain: " << bestt.gain_pc << "%" << endl;
     std::cout << "Porfolio : " << bestt.WALLET_VAL_USDT << "$ (started with 1000$)" << endl;
     std::cout << "Win rate : " << bestt.win_rate << "%" << endl;
@@ -82,7 +84,7 @@ void print_best_res(const RUN_RESULTf &bestt)
 
 //////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
-RUN_RESULTf PROCESS(const vector<KLINEf> &PAIRS, const int ema_v, const int trixLength_v, const int trixSignal_v)
+RUN_RESULTf PROCESS(const vector<KLINEf> &PAIRS, const int ema_v, const int trixLength_v, const int trixSignal_v, const int stoch_window)
 {
     nb_tested++;
 
@@ -92,10 +94,14 @@ RUN_RESULTf PROCESS(const vector<KLINEf> &PAIRS, const int ema_v, const int trix
 
     for (uint ic = 0; ic < NB_PAIRS; ic++)
     {
-        TRIX_HISTO[ic] = TALIB_TRIX(PAIRS[ic].close, trixLength_v, trixSignal_v);
+        // the percent change of the triple EMA of trixLength_v is shared by every signal length, only the signal
+        // SMA and the histogram are computed per run, in one pass
+        const float *trix_pct = INDICATORS[ic].span(PAIRS[ic], {IND_TRIX_PCT, trixLength_v});
+        TRIX_HISTO[ic].resize(PAIRS[ic].nb);
+        TALIB_TRIX_from_pct(trix_pct, PAIRS[ic].nb, trixSignal_v, TRIX_HISTO[ic].data());
     }
 
-    const uint nb_max = PAIRS[0].nb;
+    const uint nb_max = AXIS.nb;
 
     bool LAST_ITERATION = false;
     bool OPEN_LONG_CONDI = false;
@@ -116,9 +122,36 @@ RUN_RESULTf PROCESS(const vector<KLINEf> &PAIRS, const int ema_v, const int trix
     }
     uint ACTIVE_POSITIONS = 0;
 
-    const uint ii_begin = start_indexes[0];
+    // EMAs and StochRSI of this run, resolved once: the bar loop only reads spans
+    array<const float *, NB_PAIRS> EMA, StochRSI_LISTS;
+    for (uint ic = 0; ic < NB_PAIRS; ic++)
+    {
+        EMA[ic] = INDICATORS[ic].span(PAIRS[ic], {IND_EMA, ema_v});
+        StochRSI_LISTS[ic] = INDICATORS[ic].span(PAIRS[ic], {IND_STOCHRSI, stoch_window, 14});
+    }
+
+    // the conditions only depend on prices and indicators: they are computed for the whole run, then the loop visits the
+    // bars where a position can open or close
+    PAIR_SIGNALS SIGNALS(NB_PAIRS, nb_max);
+    for (uint ic = 0; ic < NB_PAIRS; ic++)
+    {
+        const float *close = PAIRS[ic].close.data();
+        const float *ema = EMA[ic];
+        const float *trix_histo = TRIX_HISTO[ic].data();
+        const float *stoch_rsi = StochRSI_LISTS[ic];
+        SIGNALS.set_pair(
+            AXIS, ic, start_indexes[ic],
+            [=](const uint jj)
+            { return (close[jj] > ema[jj]) & (trix_histo[jj] > 0.0f) & (stoch_rsi[jj] < STOCH_RSI_UPPER); },
+            [=](const uint jj)
+            { return (trix_histo[jj] < 0.0f) & (stoch_rsi[jj] > STOCH_RSI_LOWER); });
+    }
+    const auto next_bar = [&](const uint ii)
+    { return SIGNALS.next_event(ii, COIN_AMOUNTS.data(), ACTIVE_POSITIONS < MAX_OPEN_TRADES); };
+
+    const uint ii_begin = *std::min_element(start_indexes, start_indexes + NB_PAIRS);
 
-    for (uint ii = ii_begin; ii < nb_max; ii++)
+    for (uint ii = next_bar(ii_begin); ii < nb_max; ii = next_bar(ii + 1))
     {
         if (ii == nb_max - 1)
             LAST_ITERATION = true;
@@ -127,20 +160,21 @@ RUN_RESULTf PROCESS(const vector<KLINEf> &PAIRS, const int ema_v, const int trix
         // For all paits, check to close and open positions
         for (uint ic = 0; ic < NB_PAIRS; ic++)
         {
-            if (ii < start_indexes[ic])
+            if (ii < start_indexes[ic] || AXIS.is_gap(ic, ii))
                 continue;
+            const uint jj = AXIS.local(ic, ii); // bar ii of the axis in the pair's own data
 
             // conditions for open / close position
 
-            OPEN_LONG_CONDI = PAIRS[ic].close[ii] > EMA_LISTS[ic]["EMA_" + std::to_string(ema_v)][ii] && TRIX_HISTO[ic][ii] > 0.0f && StochRSI_LISTS[ic][ii] < STOCH_RSI_UPPER;
-            CLOSE_LONG_CONDI = TRIX_HISTO[ic][ii] < 0.0f && StochRSI_LISTS[ic][ii] > STOCH_RSI_LOWER;
+            OPEN_LONG_CONDI = SIGNALS.open(ic, ii);
+            CLOSE_LONG_CONDI = SIGNALS.close(ic, ii);
 
             // IT IS IMPORTANT TO CHECK FIRST FOR CLOSING POSITION AND ONLY THEN FOR OPENING POSITION
 
             // CLOSE LONG
             if (COIN_AMOUNTS[ic] > 0.0f && (CLOSE_LONG_CONDI || LAST_ITERATION))
             {
-                const float to_add = COIN_AMOUNTS[ic] * PAIRS[ic].close[ii];
+                const float to_add = COIN_AMOUNTS[ic] * PAIRS[ic].close[jj];
                 USDT_amount += to_add;
                 COIN_AMOUNTS[ic] = 0.0f;
 
@@ -151,7 +185,7 @@ RUN_RESULTf PROCESS(const vector<KLINEf> &PAIRS, const int ema_v, const int trix
                 USDT_amount -= fe;
                 total_fees_paid_USDT += fe;
                 //
-                if (PAIRS[ic].close[ii] >= price_position_open[ic])
+                if (PAIRS[ic].close[jj] >= price_position_open[ic])
                 {
                     nb_profit++;
                 }
@@ -165,17 +199,17 @@ RUN_RESULTf PROCESS(const vector<KLINEf> &PAIRS, const int ema_v, const int trix
             // OPEN LONG
             if (COIN_AMOUNTS[ic] == 0.0f && OPEN_LONG_CONDI && LAST_ITERATION == false && ACTIVE_POSITIONS < MAX_OPEN_TRADES)
             {
-                price_position_open[ic] = PAIRS[ic].close[ii];
+                price_position_open[ic] = PAIRS[ic].close[jj];
 
                 const float usdMultiplier = 1.0f / float(MAX_OPEN_TRADES - ACTIVE_POSITIONS);
 
-                COIN_AMOUNTS[ic] = USDT_amount * usdMultiplier / PAIRS[ic].close[ii];
+                COIN_AMOUNTS[ic] = USDT_amount * usdMultiplier / PAIRS[ic].close[jj];
                 USDT_amount -= USDT_amount * usdMultiplier;
 
                 // apply FEEs
                 const float fe = COIN_AMOUNTS[ic] * FEE / 100.0f;
                 COIN_AMOUNTS[ic] -= fe;
-                total_fees_paid_USDT += fe * PAIRS[ic].close[ii];
+                total_fees_paid_USDT += fe * PAIRS[ic].close[jj];
                 //
 
                 ACTIVE_POSITIONS++;
@@ -188,7 +222,7 @@ RUN_RESULTf PROCESS(const vector<KLINEf> &PAIRS, const int ema_v, const int trix
         {
             array<float, NB_PAIRS> closes{};
             for (uint ic = 0; ic < NB_PAIRS; ic++)
-                closes[ic] = PAIRS[ic].close[ii];
+                closes[ic] = AXIS.listed(ic, ii) ? PAIRS[ic].close[AXIS.local(ic, ii)] : 0.0f;
 
             WALLET_VAL_USDT = USDT_amount + vector_product(COIN_AMOUNTS, closes);
             if (WALLET_VAL_USDT > MAX_WALLET_VAL_USDT)
@@ -202,7 +236,7 @@ RUN_RESULTf PROCESS(const vector<KLINEf> &PAIRS, const int ema_v, const int trix
 
     array<float, NB_PAIRS> last_closes{};
     for (uint ic = 0; ic < NB_PAIRS; ic++)
-        last_closes[ic] = PAIRS[ic].close[nb_max - 1];
+        last_closes[ic] = PAIRS[ic].close[PAIRS[ic].nb - 1];
 
     WALLET_VAL_USDT = USDT_amount + vector_product(COIN_AMOUNTS, last_closes);
 
@@ -229,105 +263,27 @@ RUN_RESULTf PROCESS(const vector<KLINEf> &PAIRS, const int ema_v, const int trix
     result.ema1 = ema_v;
     result.trixLength = trixLength_v;
     result.trixSignal = trixSignal_v;
+    result.stoch_window = stoch_window;
     result.total_fees_paid = total_fees_paid_USDT;
 
     return result;
 }
 
-//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
-int super_index = 0;
-long int previous_ts = 0;
-int nb_read = 0;
-KLINEf read_input_data(const string &input_file_path)
-{
-    KLINEf kline;
-
-    ifstream myfile(input_file_path);
-    string line;
-    long int ts;
-    float op, hi, lo, cl, vol;
-    previous_ts = 0;
-    ifstream file(input_file_path);
-    string value;
-    vector<string> getInform;
-    nb_read=0;
-    while (file.good())
-    {
-        getline(file, value);
-        value = ReplaceAll(value, ";", " ");
-        getInform.push_back(value);
-        // getInform.erase(getInform.begin()+1);
-        stringstream ss{};
-        ss << value;
-        ss >> ts >> op >> hi >> lo >> cl >> vol;
-        kline.timestamp.push_back(ts / 1000);
-        if (previous_ts==ts) {
-            std::cout << "FOUND DUPLICATE TS at index " << nb_read << "; INGNORING. "<< std::endl;
-            previous_ts = ts / 1000;
-            continue;
-        }
-        previous_ts = ts;
-        kline.open.push_back(op);
-        kline.high.push_back(hi);
-        kline.low.push_back(lo);
-        kline.close.push_back(cl);
-        nb_read++;
-    }
-
-    myfile.close();
-
-    kline.nb = int(kline.close.size());
-
-    std::cout << "Loaded data file." << endl;
-    return kline;
-}
-
 //////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 void INITIALIZE_DATA(vector<KLINEf> &PAIRS)
 // will modify PAIRS since it is passed as reference
 {
     std::cout << "Running INITIALIZE_DATA..." << endl;
 
-    start_indexes[0] = find_max(range_EMA) + 2;
+    // pairs trade once the indicators are warmed up on their own data
+    const uint warmup = find_max(range_EMA) + 2;
 
-    // find initial indexes (different starting times)
-    for (uint i = 0; i < PAIRS[0].timestamp.size(); i++)
-    {
-        for (uint ic = 1; ic < NB_PAIRS; ic++)
-        {
-            if (PAIRS[ic].timestamp[0] == PAIRS[0].timestamp[i])
-            {
-                start_indexes[ic] = start_indexes[0] + i;
-                std::cout << "Start for " + COINS[ic] << " : " << i << endl;
-            }
-        }
-    }
-
-    for (uint ic = 1; ic < NB_PAIRS; ic++)
-    {
-        while (PAIRS[ic].close.size() < PAIRS[0].close.size())
-        {
-            PAIRS[ic].timestamp.insert(PAIRS[ic].timestamp.begin(), 0);
-            PAIRS[ic].open.insert(PAIRS[ic].open.begin(), 0.0f);
-            PAIRS[ic].high.insert(PAIRS[ic].high.begin(), 0.0f);
-            PAIRS[ic].low.insert(PAIRS[ic].low.begin(), 0.0f);
-            PAIRS[ic].close.insert(PAIRS[ic].close.begin(), 0.0f);
-            PAIRS[ic].nb++;
-        }
-
-        for (uint ii = 0; ii < start_indexes[ic] + 5; ii++)
-        {
-            PAIRS[ic].timestamp[ii] = PAIRS[0].timestamp[ii];
-        }
-    }
-
-    for (uint ic = 1; ic < NB_PAIRS; ic++)
+    AXIS = align_pairs(PAIRS);
+    for (uint ic = 0; ic < NB_PAIRS; ic++)
     {
-        if (PAIRS[ic].nb != PAIRS[0].nb || PAIRS[ic].open.size() != PAIRS[0].open.size())
-        {
-            std::cout << "ERROR: incosistent size" << endl;
-            abort();
-        }
+        start_indexes[ic] = warmup + AXIS.first[ic];
+        std::cout << "Start for " + COINS[ic] << " : " << AXIS.first[ic] << endl;
+        INDICATORS[ic].store_in(INDICATOR_STORE_DIR, PAIRS[ic]);
     }
 
     //
@@ -336,12 +292,23 @@ void INITIALIZE_DATA(vector<KLINEf> &PAIRS)
         std::cout << "Calculating for " << COINS[ic] << endl;
 
         // StochRSI = TALIB_STOCHRSI_K(kline.d_close,14,3,3);
-        StochRSI_LISTS[ic] = TALIB_STOCHRSI_not_averaged(PAIRS[ic].close, 14, 14);
+        vector<INDICATOR_SPEC> stoch_specs;
+        for (const int window : range_StochRSI_window)
+        {
+            stoch_specs.push_back({IND_STOCHRSI, window, 14});
+        }
+        INDICATORS[ic].resolve(PAIRS[ic], stoch_specs);
         // std::cout << "Calculated STOCHRSI." << endl;
 
-        for (const uint i : range_EMA)
+        vector<INDICATOR_SPEC> ema_specs;
+        for (const int i : range_EMA)
+        {
+            ema_specs.push_back({IND_EMA, i});
+        }
+        INDICATORS[ic].resolve(PAIRS[ic], ema_specs);
+        for (const int trixL : range_trixLength)
         {
-            EMA_LISTS[ic]["EMA_" + std::to_string(i)] = TALIB_EMA(PAIRS[ic].close, i);
+            INDICATORS[ic].resolve(PAIRS[ic], {IND_TRIX_PCT, trixL});
         }
         // std::cout << "Calculated EMAs." << endl;
     }
@@ -351,7 +318,7 @@ void INITIALIZE_DATA(vector<KLINEf> &PAIRS)
 
 //////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
-int main()
+int main(int argc, char **argv)
 {
     const double t_begin = get_wall_time();
     std::cout << "\n-------------------------------------" << endl;
@@ -362,6 +329,10 @@ int main()
         std::cout << dataf << endl;
     }
 
+    const DATA_MODE data_mode = parse_data_mode(argc, argv);
+    if (run_data_command(data_mode, DATAFILES))
+        return 0;
+
     TA_RetCode retCode;
     retCode = TA_Initialize();
     if (retCode != TA_SUCCESS)
@@ -374,26 +345,21 @@ int main()
         std::cout << "Initialized TA-Lib !\n";
     }
 
-    vector<KLINEf> PAIRS;
-    PAIRS.reserve(NB_PAIRS);
-    for (const string &dataf : DATAFILES)
-    {
-        PAIRS.push_back(read_input_data(dataf));
-    }
+    vector<KLINEf> PAIRS = read_kline_files_parallel(DATAFILES, KLINE_TIMESTAMP | KLINE_CLOSE);
 
     INITIALIZE_DATA(PAIRS); // this function modifies PAIRS
 
     best.gain_over_DDC = -100.0f;
 
-    const uint last_idx = PAIRS[0].nb - 1;
+    const uint last_idx = AXIS.nb - 1;
 
-    const int year = get_year_from_timestamp(PAIRS[0].timestamp[0]);
-    const int month = get_month_from_timestamp(PAIRS[0].timestamp[0]);
-    const int day = get_day_from_timestamp(PAIRS[0].timestamp[0]);
+    const int year = get_year_from_timestamp(AXIS.timestamp[0]);
+    const int month = get_month_from_timestamp(AXIS.timestamp[0]);
+    const int day = get_day_from_timestamp(AXIS.timestamp[0]);
 
-    const int last_year = get_year_from_timestamp(PAIRS[0].timestamp[last_idx]);
-    const int last_month = get_month_from_timestamp(PAIRS[0].timestamp[last_idx]);
-    const int last_day = get_day_from_timestamp(PAIRS[0].timestamp[last_idx]);
+    const int last_year = get_year_from_timestamp(AXIS.timestamp[last_idx]);
+    const int last_month = get_month_from_timestamp(AXIS.timestamp[last_idx]);
+    const int last_day = get_day_from_timestamp(AXIS.timestamp[last_idx]);
 
     // Display info
     std::cout << "Begin day      : " << year << "/" << month << "/" << day << endl;
@@ -416,11 +382,14 @@ int main()
         {
             for (const int trixS : range_trixSignal)
             {
-                const RUN_RESULTf res = PROCESS(PAIRS, ema, trixL, trixS);
-
-                if (res.gain_over_DDC > best.gain_over_DDC && res.gain_pc < 1000000.0f && res.nb_posi_entered >= MIN_NUMBER_OF_TRADES && res.max_DD > MIN_ALLOWED_MAX_DRAWBACK)
+                for (const int stoch_window : range_StochRSI_window)
                 {
-                    best = res;
+                    const RUN_RESULTf res = PROCESS(PAIRS, ema, trixL, trixS, stoch_window);
+
+                    if (res.gain_over_DDC > best.gain_over_DDC && res.gain_pc < 1000000.0f && res.nb_posi_entered >= MIN_NUMBER_OF_TRADES && res.max_DD > MIN_ALLOWED_MAX_DRAWBACK)
+                    {
+                        best = res;
+                    }
                 }
             }
         }
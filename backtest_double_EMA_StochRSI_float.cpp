@@ -37,10 +37,7 @@ uint i_print = 0;
 
 std::unordered_map<std::string, std::vector<float>> EMA_LISTS{};
 std::vector<float> StochRSI{};
-std::vector<float> year{};
-std::vector<float> hour{};
-std::vector<float> month{};
-std::vector<float> day{};
+CALENDAR_INDEX CALENDAR;
 uint nb_tested = 0;
 
 //////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -102,15 +99,12 @@ void INITIALIZE_DATA(const KLINEf &kline)
     StochRSI = TALIB_STOCHRSI_not_averaged(kline.close, 14, 14);
     cout << "Calculated STOCHRSI." << endl;
 
+    CALENDAR = build_calendar_index(kline.timestamp);
+
     float yy_b = 1990;
     for (uint ii = 0; ii < kline.nb; ii++)
     {
-        const float yy = get_year_from_timestamp(kline.timestamp[ii]);
-        year.push_back(yy);
-        hour.push_back(get_hour_from_timestamp(kline.timestamp[ii]));
-        month.push_back(get_month_from_timestamp(kline.timestamp[ii]));
-        day.push_back(get_day_from_timestamp(kline.timestamp[ii]));
-        // if (ii<100) cout << StochRSI[ii] << endl;
+        const float yy = CALENDAR.year(ii);
         if (yy >= start_year && yy_b < start_year)
         {
             i_start_year = ii;
@@ -118,7 +112,7 @@ void INITIALIZE_DATA(const KLINEf &kline)
         yy_b = yy;
     }
 
-    MIN_NUMBER_OF_TRADES = MIN_NUMBER_OF_TRADES_PER_YEAR * int(find_max(year) - find_min(year) + 1);
+    MIN_NUMBER_OF_TRADES = MIN_NUMBER_OF_TRADES_PER_YEAR * int(CALENDAR.year(kline.nb - 1) - CALENDAR.year(0) + 1);
 
     cout << "Initialized calculations." << endl;
 }
@@ -205,9 +199,9 @@ RUN_RESULTf PROCESS(const KLINEf &KLINEf, const int ema1_v, const int ema2_v)
         }
 
         // check yealy gains
-        if (year[ii - 1] != year[ii] || ii == KLINEf.nb - 1)
+        if ((CALENDAR.flags[ii] & CAL_NEW_YEAR) || ii == KLINEf.nb - 1)
         {
-            result.years_yearly_gains.push_back(year[ii - 1]);
+            result.years_yearly_gains.push_back(CALENDAR.year(ii - 1));
             WALLET_VAL_USDT = USDT_amount + COIN_AMOUNT * close[ii];
             const float yg = (WALLET_VAL_USDT - WALLET_VAL_begin_year) / WALLET_VAL_begin_year * 100.0;
             result.yearly_gains.push_back(std::round(yg * 100.0) / 100.0);
@@ -262,54 +256,6 @@ RUN_RESULTf PROCESS(const KLINEf &KLINEf, const int ema1_v, const int ema2_v)
     return result;
 }
 
-//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
-int super_index = 0;
-long int previous_ts = 0;
-int nb_read = 0;
-KLINEf read_input_data(const string &input_file_path)
-{
-    KLINEf kline;
-
-    ifstream myfile(input_file_path);
-    string line;
-    long int ts;
-    float op, hi, lo, cl, vol;
-    previous_ts = 0;
-    ifstream file(input_file_path);
-    string value;
-    vector<string> getInform;
-    nb_read=0;
-    while (file.good())
-    {
-        getline(file, value);
-        value = ReplaceAll(value, ";", " ");
-        getInform.push_back(value);
-        // getInform.erase(getInform.begin()+1);
-        stringstream ss{};
-        ss << value;
-        ss >> ts >> op >> hi >> lo >> cl >> vol;
-        kline.timestamp.push_back(ts / 1000);
-        if (previous_ts==ts) {
-            std::cout << "FOUND DUPLICATE TS at index " << nb_read << "; INGNORING. "<< std::endl;
-            previous_ts = ts / 1000;
-            continue;
-        }
-        previous_ts = ts;
-        kline.open.push_back(op);
-        kline.high.push_back(hi);
-        kline.low.push_back(lo);
-        kline.close.push_back(cl);
-        nb_read++;
-    }
-
-    myfile.close();
-
-    kline.nb = int(kline.close.size());
-
-    std::cout << "Loaded data file." << std::endl;
-    return kline;
-}
-
 //////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
 int main()
@@ -344,7 +290,7 @@ int main()
         std::cout << "Initialized TA-Lib !\n";
     }
 
-    const KLINEf kline = read_input_data(DATAFILE);
+    const KLINEf kline = read_kline_file(DATAFILE, KLINE_TIMESTAMP | KLINE_CLOSE);
 
     INITIALIZE_DATA(kline);
 
@@ -354,8 +300,9 @@ int main()
     int i_print2 = 0;
 
     // Display info
-    std::cout << "Begin day      : " << year[i_start_year] << "/" << month[i_start_year] << "/" << day[i_start_year] << std::endl;
-    std::cout << "End day        : " << year.back() << "/" << month.back() << "/" << day.back() << std::endl;
+    const uint last_idx = kline.nb - 1;
+    std::cout << "Begin day      : " << CALENDAR.year(i_start_year) << "/" << CALENDAR.month(i_start_year) << "/" << int(CALENDAR.day[i_start_year]) << std::endl;
+    std::cout << "End day        : " << CALENDAR.year(last_idx) << "/" << CALENDAR.month(last_idx) << "/" << int(CALENDAR.day[last_idx]) << std::endl;
     std::cout << "OPEN/CLOSE FEE : " << FEE << " %" << std::endl;
     std::cout << "Minimum number of trades required    : " << MIN_NUMBER_OF_TRADES << std::endl;
     std::cout << "Maximum drawback (=drawdown) allowed : " << MIN_ALLOWED_MAX_DRAWBACK << " %" << std::endl;
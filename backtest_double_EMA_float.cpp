@@ -35,11 +35,10 @@ std::vector<int> range_trixLength = integer_range(2, period_max_EMA, range_step)
 
 uint i_print = 0;
 
-std::unordered_map<std::string, std::vector<float>> EMA_LISTS{};
-std::vector<float> year{};
-std::vector<float> hour{};
-std::vector<float> month{};
-std::vector<float> day{};
+INDICATOR_REGISTRY EMA_LISTS{};
+const size_t EMA_CACHE_BYTES = size_t(1) << 30; // 0 keeps every EMA computed
+const size_t EMA_TILE = 64;                     // the sweep runs EMA_TILE x EMA_TILE blocks of (ema1, ema2): keep 2 * EMA_TILE EMAs within the budget
+CALENDAR_INDEX CALENDAR;
 uint nb_tested = 0;
 
 const float USDT_amount_initial = 1000.0;
@@ -80,27 +79,24 @@ void print_best_res(const RUN_RESULTf best)
 //////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 void INITIALIZE_DATA(const KLINEf &kline)
 {
-    std::vector<int> list_ema = {};
+    // EMAs are computed (or mapped from the store) tile by tile before the runs that use them, within EMA_CACHE_BYTES
+    EMA_LISTS.budget_bytes = EMA_CACHE_BYTES;
+    EMA_LISTS.store_in(INDICATOR_STORE_DIR, kline);
 
-    for (uint i = 2; i <= std::max(find_max(range_EMA), find_max(range_trixLength)) + 5; i++)
-    {
-        list_ema.push_back(i);
-    }
+    CALENDAR = build_calendar_index(kline.timestamp);
 
-    for (const uint i : list_ema)
-    {
-        EMA_LISTS["EMA" + std::to_string(i)] = TALIB_EMA(kline.close, i);
-    }
+    cout << "Initialized calculations."<< endl;
+}
 
-    for (uint ii = 0; ii < kline.nb; ii++)
+// the EMAs of the tile of range starting at begin
+std::vector<INDICATOR_SPEC> tile_ema_specs(const std::vector<int> &range, const size_t begin)
+{
+    std::vector<INDICATOR_SPEC> specs;
+    for (size_t i = begin; i < std::min(begin + EMA_TILE, range.size()); i++)
     {
-        year.push_back(get_year_from_timestamp(kline.timestamp[ii]));
-        hour.push_back(get_hour_from_timestamp(kline.timestamp[ii]));
-        month.push_back(get_month_from_timestamp(kline.timestamp[ii]));
-        day.push_back(get_day_from_timestamp(kline.timestamp[ii]));
+        specs.push_back({IND_EMA, range[i]});
     }
-
-    cout << "Initialized calculations."<< endl;
+    return specs;
 }
 
 //////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -128,8 +124,10 @@ bool check_if_liquidated(const double USDT_amount_check, const double LEV)
 
 RUN_RESULTf PROCESS(const KLINEf &KLINEf, const int ema1_v, const int ema2_v)
 {
-    std::vector<float> EMA1 = EMA_LISTS["EMA" + std::to_string(ema1_v)];
-    std::vector<float> EMA2 = EMA_LISTS["EMA" + std::to_string(ema2_v)];
+    const uint handle1 = EMA_LISTS.acquire(KLINEf, {IND_EMA, ema1_v});
+    const uint handle2 = EMA_LISTS.acquire(KLINEf, {IND_EMA, ema2_v});
+    const float *EMA1 = EMA_LISTS.span(handle1);
+    const float *EMA2 = EMA_LISTS.span(handle2);
 
     bool LAST_ITERATION = false, OPEN_LONG_CONDI = false, OPEN_SHORT_CONDI = false, CLOSE_LONG_CONDI = false, CLOSE_SHORT_CONDI = false;
     bool IN_POSITION = false, IN_LONG = false, IN_SHORT = false;
@@ -223,7 +221,7 @@ RUN_RESULTf PROCESS(const KLINEf &KLINEf, const int ema1_v, const int ema2_v)
 
         if (IN_POSITION)
         {
-            if (((hour[ii] >= 2) && (hour[ii - 1] < 2)) || ((hour[ii] >= 10) && (hour[ii - 1] < 10)) || ((hour[ii] >= 18) && (hour[ii - 1] < 18)))
+            if (CALENDAR.flags[ii] & CAL_FUNDING)
             {
                 float to_rm = current_price / price_position_open * FRACTION_PER_POSI * USDT_amount * LEV * FUNDING_FEE / 100.0;
                 USDT_amount = USDT_amount - to_rm;
@@ -355,6 +353,9 @@ RUN_RESULTf PROCESS(const KLINEf &KLINEf, const int ema1_v, const int ema2_v)
         }
     }
 
+    EMA_LISTS.release(handle1);
+    EMA_LISTS.release(handle2);
+
     float gain = (USDT_amount - USDT_amount_initial) / USDT_amount_initial * 100.0;
     float WR = float(nb_profit) / float(NB_POSI_ENTERED) * 100.0;
 
@@ -386,52 +387,6 @@ RUN_RESULTf PROCESS(const KLINEf &KLINEf, const int ema1_v, const int ema2_v)
     return result;
 }
 
-//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
-int super_index = 0;
-long int previous_ts = 0;
-int nb_read = 0;
-KLINEf read_input_data(const string &input_file_path)
-{
-    KLINEf kline;
-
-    ifstream myfile(input_file_path);
-    string line;
-    long int ts;
-    float op, hi, lo, cl, vol;
-    previous_ts = 0;
-    ifstream file(input_file_path);
-    string value;
-    vector<string> getInform;
-    nb_read=0;
-    while (file.good())
-    {
-        getline(file, value);
-        value = ReplaceAll(value, ";", " ");
-        getInform.push_back(value);
-        // getInform.erase(getInform.begin()+1);
-        stringstream ss{};
-        ss << value;
-        ss >> ts >> op >> hi >> lo >> cl >> vol;
-        kline.timestamp.push_back(ts / 1000);
-        if (previous_ts==ts) {
-            std::cout << "FOUND DUPLICATE TS at index " << nb_read << "; INGNORING. "<< std::endl;
-            previous_ts = ts / 1000;
-            continue;
-        }
-        previous_ts = ts;
-        kline.open.push_back(op);
-        kline.high.push_back(hi);
-        kline.low.push_back(lo);
-        kline.close.push_back(cl);
-        nb_read++;
-    }
-
-    myfile.close();
-
-    kline.nb = int(kline.close.size());
-    return kline;
-}
-
 //////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
 int main()
@@ -455,7 +410,7 @@ int main()
         std::cout << "Initialized TA-Lib !\n";
     }
 
-    KLINEf kline = read_input_data(DATAFILE);
+    KLINEf kline = read_kline_file(DATAFILE, KLINE_TIMESTAMP | KLINE_CLOSE);
 
     if (LEV == 1.0 && CAN_SHORT == false)
     { // no funding fees if SPOT (equivalent to no short and leverage 1)
@@ -469,8 +424,9 @@ int main()
 
     int i_print2 = 0;
 
-    std::cout << "Begin day      : " << year[0] << "/" << month[0] << "/" << day[0] << std::endl;
-    std::cout << "End day        : " << year.back() << "/" << month.back() << "/" << day.back() << std::endl;
+    const uint last_idx = kline.nb - 1;
+    std::cout << "Begin day      : " << CALENDAR.year(0) << "/" << CALENDAR.month(0) << "/" << int(CALENDAR.day[0]) << std::endl;
+    std::cout << "End day        : " << CALENDAR.year(last_idx) << "/" << CALENDAR.month(last_idx) << "/" << int(CALENDAR.day[last_idx]) << std::endl;
     std::cout << "OPEN/CLOSE FEE : " << FEE << " %" << std::endl;
     std::cout << "FUNDING FEE    : " << FUNDING_FEE << " %" << std::endl;
     std::cout << "LEVERAGE       : " << LEV << std::endl;
@@ -484,21 +440,32 @@ int main()
 
     // MAIN LOOP
 
-    for (int ema1 : range_EMA)
+    // tile by tile, so that only about 2 * EMA_TILE EMAs need to stay in EMA_LISTS at a time
+    for (size_t t1 = 0; t1 < range_EMA.size(); t1 += EMA_TILE)
     {
-        for (int ema2 : range_trixLength)
+        EMA_LISTS.resolve(kline, tile_ema_specs(range_EMA, t1));
+        for (size_t t2 = 0; t2 < range_trixLength.size(); t2 += EMA_TILE)
         {
-            if (ema1 == ema2)
-                continue;
+            EMA_LISTS.resolve(kline, tile_ema_specs(range_trixLength, t2));
+            for (size_t i1 = t1; i1 < std::min(t1 + EMA_TILE, range_EMA.size()); i1++)
+            {
+                for (size_t i2 = t2; i2 < std::min(t2 + EMA_TILE, range_trixLength.size()); i2++)
+                {
+                    const int ema1 = range_EMA[i1];
+                    const int ema2 = range_trixLength[i2];
+                    if (ema1 == ema2)
+                        continue;
 
-            RUN_RESULTf res = PROCESS(kline, ema1, ema2);
+                    RUN_RESULTf res = PROCESS(kline, ema1, ema2);
 
-            const float days_between_portfolio_ath = float(res.max_delta_t_new_ATH) / 3600.0 / 24.0;
+                    const float days_between_portfolio_ath = float(res.max_delta_t_new_ATH) / 3600.0 / 24.0;
 
-            if (res.gain_over_DDC > best.gain_over_DDC && res.gain_pc < 10000.0 && res.nb_posi_entered >= MIN_NUMBER_OF_TRADES // should do at least 100 trades
-                && res.max_DD > MIN_ALLOWED_MAX_DRAWBACK && days_between_portfolio_ath < MAX_ALLOWED_DAYS_BETWEEN_PORTFOLIO_ATH)
-            {
-                best = res;
+                    if (res.gain_over_DDC > best.gain_over_DDC && res.gain_pc < 10000.0 && res.nb_posi_entered >= MIN_NUMBER_OF_TRADES // should do at least 100 trades
+                        && res.max_DD > MIN_ALLOWED_MAX_DRAWBACK && days_between_portfolio_ath < MAX_ALLOWED_DAYS_BETWEEN_PORTFOLIO_ATH)
+                    {
+                        best = res;
+                    }
+                }
             }
         }
     }
@@ -507,6 +474,7 @@ int main()
     double t_end = get_wall_time();
 
     std::cout << "Number of backtests performed : " << nb_tested << std::endl;
+    std::cout << "EMAs computed / evicted       : " << EMA_LISTS.nb_computed << " / " << EMA_LISTS.nb_evicted << std::endl;
     std::cout << "Time taken                    : " << t_end - t_begin << " seconds " << std::endl;
     double ram_usage = process_mem_usage();
     std::cout << "RAM usage                     : " << std::round(ram_usage * 10.0) / 10.0 << " MB" << std::endl;
@@ -0,0 +1,576 @@
+#include <iostream>
+#include <vector>
+#include <string>
+#include <fstream>
+#include <sstream>
+#include <random>
+#include <chrono>
+#include <functional>
+#include <cstdio>
+#include <sys/stat.h>
+#include <math.h>
+#include "tools.hh"
+#include "custom_talib_wrapper.hh"
+using namespace std;
+using uint = unsigned int;
+
+// Microbenchmarks for the shared data / indicator code. Run with "make bench && ./benchmarks.exe".
+
+const uint NB_REPEAT = 5;
+
+// one year of 5m bars is 105120 lines; five years is the size of a Binance 5m history since 2017
+const uint NB_LINES_5M = 5 * 105120;
+const string BENCH_FILE_5M = "/tmp/backtest_bench_5m.csv";
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+// best wall time over NB_REPEAT runs, in milliseconds
+double time_best_ms(const function<void()> &run)
+{
+    double best = 1e30;
+    for (uint i = 0; i < NB_REPEAT; i++)
+    {
+        const auto t0 = chrono::steady_clock::now();
+        run();
+        const auto t1 = chrono::steady_clock::now();
+        best = min(best, chrono::duration<double, milli>(t1 - t0).count());
+    }
+    return best;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+// writes a random walk in the Binance "ts;open;high;low;close;volume" format
+void write_synthetic_kline_file(const string &path, const uint nb_lines)
+{
+    ofstream out(path);
+    mt19937 gen(42);
+    normal_distribution<double> step(0.0, 0.002);
+    uniform_real_distribution<double> wick(0.0, 0.003);
+    uniform_real_distribution<double> volume(0.0, 500.0);
+
+    long int ts = 1502942400000;
+    double close = 4261.48;
+    char line[160];
+    for (uint i = 0; i < nb_lines; i++)
+    {
+        const double open = close;
+        close = open * (1.0 + step(gen));
+        const double high = max(open, close) * (1.0 + wick(gen));
+        const double low = min(open, close) * (1.0 - wick(gen));
+        const int n = snprintf(line, sizeof(line), "%ld;%.2f;%.2f;%.2f;%.2f;%.6f\n", ts, open, high, low, close, volume(gen));
+        out.write(line, n);
+        ts += 300000;
+    }
+}
+
+// the per-strategy parser used before tools.cpp got read_kline_file(): one string and one stringstream per line
+KLINEf read_kline_file_stringstream(const string &input_file_path)
+{
+    KLINEf kline;
+    long int ts, previous_ts = 0;
+    float op, hi, lo, cl, vol;
+    ifstream file(input_file_path);
+    string value;
+    while (file.good())
+    {
+        getline(file, value);
+        if (value.empty())
+            continue;
+        value = ReplaceAll(value, ";", " ");
+        stringstream ss{};
+        ss << value;
+        ss >> ts >> op >> hi >> lo >> cl >> vol;
+        if (previous_ts == ts)
+            continue;
+        previous_ts = ts;
+        kline.timestamp.push_back(ts / 1000);
+        kline.open.push_back(op);
+        kline.high.push_back(hi);
+        kline.low.push_back(lo);
+        kline.close.push_back(cl);
+    }
+    kline.nb = kline.close.size();
+    return kline;
+}
+
+bool same_klines(const KLINEf &a, const KLINEf &b)
+{
+    return a.nb == b.nb && a.timestamp == b.timestamp && a.open == b.open && a.high == b.high && a.low == b.low && a.close == b.close;
+}
+
+void bench_kline_parsing()
+{
+    cout << "--- OHLCV parsing, " << NB_LINES_5M << " synthetic 5m lines ---" << endl;
+
+    KLINEf legacy, fast;
+    const double t_legacy = time_best_ms([&]() { legacy = read_kline_file_stringstream(BENCH_FILE_5M); });
+    const double t_fast = time_best_ms([&]() { fast = read_kline_file(BENCH_FILE_5M, KLINE_OHLC, false); });
+
+    if (!same_klines(legacy, fast))
+    {
+        cout << "ERROR: parsers disagree on " << BENCH_FILE_5M << endl;
+        std::abort();
+    }
+
+    cout << "getline + stringstream : " << t_legacy << " ms" << endl;
+    cout << "mmap + from_chars      : " << t_fast << " ms  (x" << t_legacy / t_fast << ")" << endl;
+
+    KLINEf projected;
+    const double t_projected = time_best_ms([&]() { projected = read_kline_file(BENCH_FILE_5M, KLINE_TIMESTAMP | KLINE_CLOSE, false); });
+    if (projected.close != fast.close || projected.timestamp != fast.timestamp || !projected.open.empty())
+    {
+        cout << "ERROR: column-projected load differs on " << BENCH_FILE_5M << endl;
+        std::abort();
+    }
+    cout << "timestamp + close only : " << t_projected << " ms, " << 2 * projected.nb * 4 / 1024 << " KB instead of "
+         << 5 * fast.nb * 4 / 1024 << " KB" << endl;
+}
+
+off_t file_size(const string &path)
+{
+    struct stat st;
+    return stat(path.c_str(), &st) == 0 ? st.st_size : 0;
+}
+
+void bench_kline_compressed()
+{
+    cout << "--- compressed store (.klz) vs csv, " << NB_LINES_5M << " synthetic 5m lines ---" << endl;
+    const string compressed_path = kline_compressed_path(BENCH_FILE_5M);
+    compress_kline_files({BENCH_FILE_5M});
+
+    KLINEf parsed, decoded;
+    const double t_parse = time_best_ms([&]() { parsed = read_kline_file(BENCH_FILE_5M, KLINE_OHLC, false); });
+    const double t_decode = time_best_ms([&]() { decoded = read_kline_compressed(compressed_path); });
+
+    if (!same_klines(parsed, decoded))
+    {
+        cout << "ERROR: compressed store does not decode to the csv data" << endl;
+        std::abort();
+    }
+
+    cout << "size   csv : " << file_size(BENCH_FILE_5M) / 1024 << " KB, klz : " << file_size(compressed_path) / 1024 << " KB" << endl;
+    cout << "csv parse  : " << t_parse << " ms" << endl;
+    cout << "klz decode : " << t_decode << " ms  (x" << t_parse / t_decode << ")" << endl;
+
+    remove(compressed_path.c_str());
+}
+
+// the tools.cpp month lookup before civil_from_timestamp(): localtime + strftime + stoi
+int get_month_from_timestamp_localtime(const int timestamp)
+{
+    time_t rawtime = timestamp;
+    struct tm ts;
+    char buf[80];
+    ts = *localtime(&rawtime);
+    strftime(buf, sizeof(buf), "%m", &ts);
+    return std::stoi(buf);
+}
+
+void bench_calendar()
+{
+    cout << "--- month of " << NB_LINES_5M << " 5m timestamps ---" << endl;
+    vector<int> times(NB_LINES_5M);
+    for (uint i = 0; i < NB_LINES_5M; i++)
+    {
+        times[i] = 1502942400 + int(i) * 300;
+    }
+
+    long int sum_legacy = 0, sum_civil = 0;
+    const double t_legacy = time_best_ms([&]()
+                                         { sum_legacy = 0; for (const int t : times) sum_legacy += get_month_from_timestamp_localtime(t); });
+    const double t_civil = time_best_ms([&]()
+                                        { sum_civil = 0; for (const int t : times) sum_civil += civil_from_timestamp(t).month; });
+
+    cout << "localtime + strftime + stoi : " << t_legacy << " ms" << endl;
+    cout << "civil_from_timestamp        : " << t_civil << " ms  (x" << t_legacy / t_civil << ")"
+         << (sum_legacy == sum_civil ? "" : "  (differs: TZ is not UTC)") << endl;
+}
+
+// the cross-sectional part of a multi-pair PROCESS loop: per bar, every listed pair reads its close and two indicators
+void bench_panel_layout()
+{
+    const uint nb_pairs = 32;
+    const uint nb_bars = NB_LINES_5M / 5;
+    cout << "--- per-bar loop over " << nb_pairs << " pairs x " << nb_bars << " bars: vector<KLINEf> vs [bar][pair] panel ---" << endl;
+
+    mt19937 gen(7);
+    normal_distribution<float> step(0.0f, 0.01f);
+    uniform_real_distribution<float> unit(0.0f, 1.0f);
+
+    // staggered listings, all ending on the last bar
+    vector<KLINEf> pairs(nb_pairs);
+    vector<vector<float>> indicator_1(nb_pairs), indicator_2(nb_pairs);
+    for (uint ic = 0; ic < nb_pairs; ic++)
+    {
+        const uint first = ic * (nb_bars / (2 * nb_pairs));
+        float close = 100.0f;
+        for (uint ii = first; ii < nb_bars; ii++)
+        {
+            close *= 1.0f + step(gen);
+            pairs[ic].timestamp.push_back(ii * 3600);
+            pairs[ic].close.push_back(close);
+            indicator_1[ic].push_back(close * (1.0f + step(gen)));
+            indicator_2[ic].push_back(unit(gen));
+        }
+        pairs[ic].nb = pairs[ic].close.size();
+    }
+    const TIME_AXIS axis = align_pairs(pairs);
+
+    vector<const vector<float> *> columns_1, columns_2;
+    for (uint ic = 0; ic < nb_pairs; ic++)
+    {
+        columns_1.push_back(&indicator_1[ic]);
+        columns_2.push_back(&indicator_2[ic]);
+    }
+    const PANEL close_panel = make_panel(axis, pairs, &KLINEf::close);
+    const PANEL panel_1 = make_panel(axis, columns_1);
+    const PANEL panel_2 = make_panel(axis, columns_2);
+
+    double sum_vectors = 0.0, sum_panel = 0.0;
+    const double t_vectors = time_best_ms([&]()
+                                          {
+        sum_vectors = 0.0;
+        for (uint ii = 0; ii < axis.nb; ii++)
+            for (uint ic = 0; ic < nb_pairs; ic++)
+            {
+                if (!axis.listed(ic, ii))
+                    continue;
+                const uint jj = axis.local(ic, ii);
+                if (pairs[ic].close[jj] > indicator_1[ic][jj] && indicator_2[ic][jj] < 0.8f)
+                    sum_vectors += pairs[ic].close[jj];
+            } });
+
+    const PANEL_VIEW closes = close_panel.view(), view_1 = panel_1.view(), view_2 = panel_2.view();
+    const double t_panel = time_best_ms([&]()
+                                        {
+        sum_panel = 0.0;
+        for (uint ii = 0; ii < axis.nb; ii++)
+        {
+            const float *close = closes.bar(ii), *ind_1 = view_1.bar(ii), *ind_2 = view_2.bar(ii);
+            for (uint ic = 0; ic < nb_pairs; ic++)
+            {
+                if (!axis.listed(ic, ii))
+                    continue;
+                if (close[ic] > ind_1[ic] && ind_2[ic] < 0.8f)
+                    sum_panel += close[ic];
+            }
+        } });
+
+    if (sum_vectors != sum_panel)
+    {
+        cout << "ERROR: panel and vector<KLINEf> loops disagree" << endl;
+        std::abort();
+    }
+
+    cout << "vector<KLINEf> + per-pair indicators : " << t_vectors << " ms" << endl;
+    cout << "[bar][pair] panels                   : " << t_panel << " ms  (x" << t_vectors / t_panel << ")" << endl;
+}
+
+// the EMA precompute of the EMA sweeps: one TALIB_EMA call per period, or one EMA_BATCH pass for all of them
+void bench_ema_batch()
+{
+    const uint nb_bars = NB_LINES_5M / 5;
+    vector<int> periods;
+    for (int p = 2; p <= 600; p++)
+    {
+        periods.push_back(p);
+    }
+    cout << "--- EMAs of " << periods.size() << " periods over " << nb_bars << " bars ---" << endl;
+
+    mt19937 gen(11);
+    normal_distribution<float> step(0.0f, 0.01f);
+    vector<float> close(nb_bars);
+    float price = 100.0f;
+    for (float &c : close)
+    {
+        price *= 1.0f + step(gen);
+        c = price;
+    }
+
+    vector<vector<float>> separate(periods.size()), batch(periods.size(), vector<float>(nb_bars));
+    vector<float *> out;
+    for (vector<float> &column : batch)
+    {
+        out.push_back(column.data());
+    }
+    const double t_separate = time_best_ms([&]()
+                                           { for (size_t j = 0; j < periods.size(); j++) separate[j] = TALIB_EMA(close, periods[j]); });
+    const double t_batch = time_best_ms([&]()
+                                        { EMA_BATCH(close, periods, out.data()); });
+
+    if (separate != batch)
+    {
+        cout << "ERROR: EMA_BATCH differs from TALIB_EMA" << endl;
+        std::abort();
+    }
+
+    cout << "one TALIB_EMA per period : " << t_separate << " ms" << endl;
+    cout << "EMA_BATCH                : " << t_batch << " ms  (x" << t_separate / t_batch << ", same values)" << endl;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void bench_supertrend_batch()
+{
+    const uint nb_bars = NB_LINES_5M / 5;
+    const vector<int> windows{7, 10, 14, 15, 20, 30};
+    const vector<float> multipliers{1.0f, 1.5f, 2.5f, 3.0f, 5.0f};
+    cout << "--- SuperTrend directions of " << windows.size() << " ATR windows x " << multipliers.size() << " multipliers over "
+         << nb_bars << " bars ---" << endl;
+
+    mt19937 gen(13);
+    normal_distribution<float> step(0.0f, 0.01f);
+    uniform_real_distribution<float> wick(0.0f, 0.005f);
+    vector<float> high(nb_bars), low(nb_bars), close(nb_bars);
+    float price = 100.0f;
+    for (uint i = 0; i < nb_bars; i++)
+    {
+        price *= 1.0f + step(gen);
+        close[i] = price;
+        high[i] = price * (1.0f + wick(gen));
+        low[i] = price * (1.0f - wick(gen));
+    }
+
+    vector<vector<float>> separate(windows.size() * multipliers.size()), batch(separate.size(), vector<float>(nb_bars));
+    vector<float *> out;
+    for (vector<float> &column : batch)
+    {
+        out.push_back(column.data());
+    }
+    const double t_separate = time_best_ms([&]()
+                                           {
+        for (size_t iw = 0; iw < windows.size(); iw++)
+            for (size_t im = 0; im < multipliers.size(); im++)
+                separate[iw * multipliers.size() + im] = TALIB_SuperTrend_dir_only(high, low, close, windows[iw], multipliers[im]); });
+    const double t_batch = time_best_ms([&]()
+                                        { SUPERTREND_BATCH(high.data(), low.data(), close.data(), nb_bars, windows, multipliers, out.data()); });
+
+    if (separate != batch)
+    {
+        cout << "ERROR: SUPERTREND_BATCH differs from TALIB_SuperTrend_dir_only" << endl;
+        std::abort();
+    }
+
+    cout << "one SuperTrend per pair  : " << t_separate << " ms" << endl;
+    cout << "SUPERTREND_BATCH         : " << t_batch << " ms  (x" << t_separate / t_batch << ", same values)" << endl;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+// one reference call per window (separate(window, out)) against batch(out) over all of them, aborts unless the values are
+// the same
+template <typename SEPARATE, typename BATCH>
+void bench_window_batch(const string &name, const string &reference, const vector<int> &windows, const uint nb_bars,
+                        SEPARATE separate, BATCH batch)
+{
+    vector<vector<float>> expected(windows.size(), vector<float>(nb_bars)), batched(expected);
+    vector<float *> out;
+    for (vector<float> &column : batched)
+    {
+        out.push_back(column.data());
+    }
+    const double t_separate = time_best_ms([&]()
+                                           {
+        for (size_t j = 0; j < windows.size(); j++)
+            separate(windows[j], expected[j].data()); });
+    const double t_batch = time_best_ms([&]()
+                                        { batch(out.data()); });
+
+    for (size_t j = 0; j < windows.size(); j++)
+    {
+        if (expected[j] != batched[j])
+        {
+            cout << "ERROR: " << name << " differs from " << reference << " for window " << windows[j] << endl;
+            std::abort();
+        }
+    }
+
+    cout << name << " : " << t_batch << " ms, " << reference << " per window : " << t_separate << " ms  (x"
+         << t_separate / t_batch << ", same values)" << endl;
+}
+
+void bench_rolling_batch()
+{
+    const uint nb_bars = NB_LINES_5M / 5;
+    const vector<int> windows{2, 3, 5, 14, 21, 50, 100};
+    cout << "--- " << windows.size() << " rolling windows from " << windows.front() << " to " << windows.back() << " bars over "
+         << nb_bars << " bars: batches vs TA-lib ---" << endl;
+
+    // prices in cents, so that windows often hold the same extremum several times
+    mt19937 gen(17);
+    normal_distribution<float> step(0.0f, 0.01f);
+    uniform_real_distribution<float> wick(0.0f, 0.005f);
+    vector<float> high(nb_bars), low(nb_bars), close(nb_bars);
+    float price = 100.0f;
+    for (uint i = 0; i < nb_bars; i++)
+    {
+        price *= 1.0f + step(gen);
+        close[i] = round(price * 100.0f) / 100.0f;
+        high[i] = round(price * (1.0f + wick(gen)) * 100.0f) / 100.0f;
+        low[i] = round(price * (1.0f - wick(gen)) * 100.0f) / 100.0f;
+    }
+    const vector<float> rsi = TALIB_RSI(close, 14);
+
+    bench_window_batch("ROLLING_MAX   ", "TA_S_MAX", windows, nb_bars,
+                       [&](const int window, float *out)
+                       { TALIB_MAX(close.data(), nb_bars, window, out); },
+                       [&](float *const *out)
+                       { ROLLING_MAX(close.data(), nb_bars, windows, out); });
+    bench_window_batch("ROLLING_MIN   ", "TA_S_MIN", windows, nb_bars,
+                       [&](const int window, float *out)
+                       { TALIB_MIN(close.data(), nb_bars, window, out); },
+                       [&](float *const *out)
+                       { ROLLING_MIN(close.data(), nb_bars, windows, out); });
+    bench_window_batch("WILLR_BATCH   ", "TA_S_WILLR", windows, nb_bars,
+                       [&](const int window, float *out)
+                       { TALIB_WILLR(high.data(), low.data(), close.data(), nb_bars, window, out); },
+                       [&](float *const *out)
+                       { WILLR_BATCH(high.data(), low.data(), close.data(), nb_bars, windows, out); });
+    // StochRSI as it was computed before STOCHRSI_BATCH: TA-lib extremes of the RSI
+    bench_window_batch("STOCHRSI_BATCH", "TA_S_MAX/MIN", windows, nb_bars,
+                       [&](const int window, float *out)
+                       {
+                           const vector<float> highest_rsi = TALIB_MAX(rsi, window), lowest_rsi = TALIB_MIN(rsi, window);
+                           for (uint i = 0; i < nb_bars; i++)
+                           {
+                               float val = (rsi[i] - lowest_rsi[i]) / (highest_rsi[i] - lowest_rsi[i]);
+                               if (std::isnan(val) | std::isinf(val))
+                                   val = 0.0;
+                               out[i] = std::round(val * 1000.0) / 1000.0;
+                           }
+                       },
+                       [&](float *const *out)
+                       { STOCHRSI_BATCH(rsi.data(), nb_bars, windows, out); });
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+// appending one bar: the batch wrapper recomputes the whole series, the stream made by make_stream() updates in O(1).
+// The streamed values must be the batch values
+template <typename BATCH, typename MAKE_STREAM>
+void bench_stream(const string &name, const uint nb_bars, BATCH batch, MAKE_STREAM make_stream)
+{
+    vector<float> batch_values, streamed(nb_bars);
+    const double t_batch = time_best_ms([&]()
+                                        { batch_values = batch(); });
+    const double t_stream = time_best_ms([&]()
+                                         {
+        auto update = make_stream();
+        for (uint i = 0; i < nb_bars; i++)
+            streamed[i] = update(i); });
+
+    if (streamed != batch_values)
+    {
+        cout << "ERROR: the stream of " << name << " differs from its batch wrapper" << endl;
+        std::abort();
+    }
+    cout << name << string(std::max(0, 22 - int(name.size())), ' ') << ": recompute " << t_batch << " ms, stream update "
+         << t_stream * 1e6 / nb_bars << " ns" << endl;
+}
+
+void bench_streaming()
+{
+    const uint nb_bars = NB_LINES_5M / 5;
+    cout << "--- appending a bar to " << nb_bars << " bars: batch recompute vs streaming update ---" << endl;
+
+    mt19937 gen(17);
+    normal_distribution<float> step(0.0f, 0.01f);
+    uniform_real_distribution<float> wick(0.0f, 0.005f);
+    vector<float> high(nb_bars), low(nb_bars), close(nb_bars);
+    float price = 100.0f;
+    for (uint i = 0; i < nb_bars; i++)
+    {
+        price *= 1.0f + step(gen);
+        close[i] = price;
+        high[i] = price * (1.0f + wick(gen));
+        low[i] = price * (1.0f - wick(gen));
+    }
+
+    bench_stream("EMA(50)", nb_bars, [&]()
+                 { return TALIB_EMA(close, 50); },
+                 [&]()
+                 { return [&, s = STREAM_EMA(50)](const uint i) mutable
+                   { return s.update(close[i]); }; });
+    bench_stream("SMA(50)", nb_bars, [&]()
+                 { return TALIB_SMA(close, 50); },
+                 [&]()
+                 { return [&, s = STREAM_SMA(50)](const uint i) mutable
+                   { return s.update(close[i]); }; });
+    bench_stream("RSI(14)", nb_bars, [&]()
+                 { return TALIB_RSI(close, 14); },
+                 [&]()
+                 { return [&, s = STREAM_RSI(14)](const uint i) mutable
+                   { return s.update(close[i]); }; });
+    bench_stream("ATR(14)", nb_bars, [&]()
+                 { return TALIB_ATR(high, low, close, 14); },
+                 [&]()
+                 { return [&, s = STREAM_ATR(14)](const uint i) mutable
+                   { return s.update(high[i], low[i], close[i]); }; });
+    bench_stream("MAX(14)", nb_bars, [&]()
+                 { return TALIB_MAX(close, 14); },
+                 [&]()
+                 { return [&, s = STREAM_EXTREMUM(14, true)](const uint i) mutable
+                   { return s.update(close[i]); }; });
+    bench_stream("MIN(14)", nb_bars, [&]()
+                 { return TALIB_MIN(close, 14); },
+                 [&]()
+                 { return [&, s = STREAM_EXTREMUM(14, false)](const uint i) mutable
+                   { return s.update(close[i]); }; });
+    bench_stream("STOCHRSI(14,14)", nb_bars, [&]()
+                 { return TALIB_STOCHRSI_not_averaged(close, 14, 14); },
+                 [&]()
+                 { return [&, s = STREAM_STOCHRSI(14, 14)](const uint i) mutable
+                   { return s.update(close[i]); }; });
+    bench_stream("STOCHRSI_K(14,14,3,3)", nb_bars, [&]()
+                 { return TALIB_STOCHRSI_K(close, 14, 14, 3, 3); },
+                 [&]()
+                 { return [&, s = STREAM_STOCHRSI_KD(14, 14, 3, 3)](const uint i) mutable
+                   {
+                       s.update(close[i]);
+                       return s.k;
+                   }; });
+    bench_stream("STOCHRSI_D(14,14,3,3)", nb_bars, [&]()
+                 { return TALIB_STOCHRSI_D(close, 14, 14, 3, 3); },
+                 [&]()
+                 { return [&, s = STREAM_STOCHRSI_KD(14, 14, 3, 3)](const uint i) mutable
+                   { return s.update(close[i]); }; });
+    bench_stream("TRIX(10,22)", nb_bars, [&]()
+                 { return TALIB_TRIX(close, 10, 22); },
+                 [&]()
+                 { return [&, s = STREAM_TRIX(10, 22)](const uint i) mutable
+                   { return s.update(close[i]); }; });
+    bench_stream("SuperTrend(10,3)", nb_bars, [&]()
+                 { return TALIB_SuperTrend_dir_only(high, low, close, 10, 3); },
+                 [&]()
+                 { return [&, s = STREAM_SUPERTREND(10, 3.0f)](const uint i) mutable
+                   { return s.update(high[i], low[i], close[i]); }; });
+    bench_stream("AO(5,34)", nb_bars, [&]()
+                 { return TALIB_AO(high, low, 5, 34); },
+                 [&]()
+                 { return [&, s = STREAM_AO(5, 34)](const uint i) mutable
+                   { return s.update(high[i], low[i]); }; });
+    bench_stream("WILLR(14)", nb_bars, [&]()
+                 { return TALIB_WILLR(high, low, close, 14); },
+                 [&]()
+                 { return [&, s = STREAM_WILLR(14)](const uint i) mutable
+                   { return s.update(high[i], low[i], close[i]); }; });
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+int main()
+{
+    write_synthetic_kline_file(BENCH_FILE_5M, NB_LINES_5M);
+    bench_kline_parsing();
+    bench_kline_compressed();
+    remove(BENCH_FILE_5M.c_str());
+    remove(kline_cache_path(BENCH_FILE_5M).c_str());
+    bench_calendar();
+    bench_panel_layout();
+    bench_ema_batch();
+    bench_supertrend_batch();
+    bench_rolling_batch();
+    bench_streaming();
+    return 0;
+}
@@ -1,506 +1,642 @@
 #include "custom_talib_wrapper.hh"
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <cstring>
+#include <cerrno>
+#include <cmath>
 using namespace std;
 //////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
-std::vector<float> TALIB_MIN(const std::vector<float> &vals, const int period)
+// TA-lib writes doubles: they go to a per-thread buffer, reused by every call of the thread, then to the float output
+static TA_Real *talib_scratch(const uint nb)
 {
-    std::vector<float> OUT;
-    OUT.reserve(vals.size());
-
-    TA_Integer outBeg;
-    TA_Integer outNbElement;
-    TA_RetCode retCode;
-    TA_Real out_val[vals.size()];
-
-    int min_idx = 0;
-    int max_idx = vals.size() - 1;
-
-    retCode = TA_S_MIN(min_idx, max_idx,
-                       &vals[0],
-                       period,
-                       &outBeg,
-                       &outNbElement,
-                       &out_val[0]);
-
-    for (int ii = 0; ii < outBeg; ii++)
-    {
-        OUT.push_back(0.0);
-    }
+    thread_local std::vector<TA_Real> scratch;
+    if (scratch.size() < nb)
+        scratch.resize(nb);
+    return scratch.data();
+}
 
+// out = zeros for the outBeg warm-up bars, then the TA-lib values
+static void copy_talib_output(const TA_Real *out_val, const int outBeg, const int outNbElement, const uint nb, float *out)
+{
+    if (uint(outBeg + outNbElement) != nb)
+        abort();
+    std::fill(out, out + outBeg, 0.0f);
     for (int ii = 0; ii < outNbElement; ii++)
     {
-        OUT.push_back(out_val[ii]);
+        out[outBeg + ii] = out_val[ii];
     }
-
-    if (OUT.size() != vals.size())
-        abort();
-
-    return OUT;
 }
 
 //////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
-std::vector<float> TALIB_MAX(const std::vector<float> &vals, const int period)
+void TALIB_MIN(const float *vals, const uint nb, const int period, float *out)
 {
-    std::vector<float> OUT;
-    OUT.reserve(vals.size());
-
     TA_Integer outBeg;
     TA_Integer outNbElement;
-    TA_RetCode retCode;
-    TA_Real out_val[vals.size()];
-
-    int min_idx = 0;
-    int max_idx = vals.size() - 1;
-
-    retCode = TA_S_MAX(min_idx, max_idx,
-                       &vals[0],
-                       period,
-                       &outBeg,
-                       &outNbElement,
-                       &out_val[0]);
+    TA_Real *out_val = talib_scratch(nb);
 
-    for (int ii = 0; ii < outBeg; ii++)
-    {
-        OUT.push_back(0.0);
-    }
-
-    for (int ii = 0; ii < outNbElement; ii++)
-    {
-        OUT.push_back(out_val[ii]);
-    }
+    TA_S_MIN(0, nb - 1,
+             vals,
+             period,
+             &outBeg,
+             &outNbElement,
+             out_val);
 
-    if (OUT.size() != vals.size())
-        abort();
+    copy_talib_output(out_val, outBeg, outNbElement, nb, out);
+}
 
+std::vector<float> TALIB_MIN(const std::vector<float> &vals, const int period)
+{
+    std::vector<float> OUT(vals.size());
+    TALIB_MIN(vals.data(), vals.size(), period, OUT.data());
     return OUT;
 }
 
 //////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
-std::vector<float> TALIB_RSI(const std::vector<float> &vals, const int period)
+void TALIB_MAX(const float *vals, const uint nb, const int period, float *out)
 {
-    std::vector<float> OUT;
-    OUT.reserve(vals.size());
-
     TA_Integer outBeg;
     TA_Integer outNbElement;
-    TA_RetCode retCode;
-    TA_Real out_val[vals.size()];
+    TA_Real *out_val = talib_scratch(nb);
 
-    int min_idx = 0;
-    int max_idx = vals.size() - 1;
+    TA_S_MAX(0, nb - 1,
+             vals,
+             period,
+             &outBeg,
+             &outNbElement,
+             out_val);
 
-    retCode = TA_S_RSI(min_idx, max_idx,
-                       &vals[0],
-                       period,
-                       &outBeg,
-                       &outNbElement,
-                       &out_val[0]);
+    copy_talib_output(out_val, outBeg, outNbElement, nb, out);
+}
 
-    for (int ii = 0; ii < outBeg; ii++)
-    {
-        OUT.push_back(0.0);
-    }
+std::vector<float> TALIB_MAX(const std::vector<float> &vals, const int period)
+{
+    std::vector<float> OUT(vals.size());
+    TALIB_MAX(vals.data(), vals.size(), period, OUT.data());
+    return OUT;
+}
 
-    for (int ii = 0; ii < outNbElement; ii++)
-    {
-        OUT.push_back(out_val[ii]);
-    }
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
-    if (OUT.size() != vals.size())
-        abort();
+void TALIB_RSI(const float *vals, const uint nb, const int period, float *out)
+{
+    TA_Integer outBeg;
+    TA_Integer outNbElement;
+    TA_Real *out_val = talib_scratch(nb);
+
+    TA_S_RSI(0, nb - 1,
+             vals,
+             period,
+             &outBeg,
+             &outNbElement,
+             out_val);
 
+    copy_talib_output(out_val, outBeg, outNbElement, nb, out);
+}
+
+std::vector<float> TALIB_RSI(const std::vector<float> &vals, const int period)
+{
+    std::vector<float> OUT(vals.size());
+    TALIB_RSI(vals.data(), vals.size(), period, OUT.data());
     return OUT;
 }
 
 //////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
-std::vector<float> TALIB_EMA(const std::vector<float> &vals, const int period)
+void TALIB_EMA(const float *vals, const uint nb, const int period, float *out)
 {
-    std::vector<float> OUT;
-    OUT.reserve(vals.size());
-
     TA_Integer outBeg;
     TA_Integer outNbElement;
-    TA_RetCode retCode;
-    TA_Real out_val[vals.size()];
+    TA_Real *out_val = talib_scratch(nb);
 
-    int min_idx = 0;
-    int max_idx = vals.size() - 1;
+    TA_S_EMA(0, nb - 1,
+             vals,
+             period,
+             &outBeg,
+             &outNbElement,
+             out_val);
+
+    copy_talib_output(out_val, outBeg, outNbElement, nb, out);
+}
 
-    retCode = TA_S_EMA(min_idx, max_idx,
-                       &vals[0],
-                       period,
-                       &outBeg,
-                       &outNbElement,
-                       &out_val[0]);
+std::vector<float> TALIB_EMA(const std::vector<float> &vals, const int period)
+{
+    std::vector<float> OUT(vals.size());
+    TALIB_EMA(vals.data(), vals.size(), period, OUT.data());
+    return OUT;
+}
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
-    for (int ii = 0; ii < outBeg; ii++)
+// Same arithmetic as TA-lib's EMA, in double: the first value (bar period - 1) is the mean of the first period values,
+// summed in order, then ema = (x - ema) * k + ema with k = 2 / (period + 1). The bars are read tile by tile; within a
+// tile, EMA_GROUP periods are updated together per bar (the loop over the group is the one that vectorizes)
+void EMA_BATCH(const std::vector<float> &vals, const std::vector<int> &periods, float *const *out)
+{
+    const uint EMA_TILE = 512;
+    const uint EMA_GROUP = 8;
+    const uint nb = vals.size();
+    const uint m = periods.size();
+
+    std::vector<double> ema(m, 0.0);
+    std::vector<double> k(m);
+    for (uint j = 0; j < m; j++)
     {
-        OUT.push_back(0.0);
+        k[j] = 2.0 / double(periods[j] + 1);
     }
 
-    for (int ii = 0; ii < outNbElement; ii++)
+    double sum = 0.0; // of vals up to the current bar
+    double prefix[EMA_TILE];
+    for (uint t0 = 0; t0 < nb; t0 += EMA_TILE)
     {
-        OUT.push_back(out_val[ii]);
-    }
+        const uint t1 = std::min(nb, t0 + EMA_TILE);
+        for (uint i = t0; i < t1; i++)
+        {
+            sum += vals[i];
+            prefix[i - t0] = sum;
+        }
 
-    if (OUT.size() != vals.size())
-        abort();
+        for (uint g0 = 0; g0 < m; g0 += EMA_GROUP)
+        {
+            const uint g1 = std::min(m, g0 + EMA_GROUP);
+            bool warm = g1 - g0 == EMA_GROUP;
+            for (uint j = g0; j < g1; j++)
+            {
+                warm &= uint(periods[j]) <= t0;
+            }
 
-    return OUT;
+            if (!warm)
+            {
+                // a period of the group starts in this tile (or later)
+                for (uint j = g0; j < g1; j++)
+                {
+                    const uint first = periods[j] - 1;
+                    for (uint i = t0; i < t1; i++)
+                    {
+                        if (i < first)
+                            out[j][i] = 0.0f;
+                        else
+                        {
+                            ema[j] = i == first ? prefix[i - t0] / periods[j] : (vals[i] - ema[j]) * k[j] + ema[j];
+                            out[j][i] = ema[j];
+                        }
+                    }
+                }
+                continue;
+            }
+
+            double e[EMA_GROUP], kk[EMA_GROUP];
+            float *o[EMA_GROUP];
+            for (uint jj = 0; jj < EMA_GROUP; jj++)
+            {
+                e[jj] = ema[g0 + jj];
+                kk[jj] = k[g0 + jj];
+                o[jj] = out[g0 + jj];
+            }
+            for (uint i = t0; i < t1; i++)
+            {
+                const double x = vals[i];
+                for (uint jj = 0; jj < EMA_GROUP; jj++)
+                {
+                    e[jj] = (x - e[jj]) * kk[jj] + e[jj];
+                    o[jj][i] = e[jj];
+                }
+            }
+            for (uint jj = 0; jj < EMA_GROUP; jj++)
+            {
+                ema[g0 + jj] = e[jj];
+            }
+        }
+    }
 }
+
 //////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
-std::vector<float> TALIB_SMA(const std::vector<float> &vals, const int period)
+void TALIB_SMA(const float *vals, const uint nb, const int period, float *out)
 {
-    std::vector<float> OUT;
-    OUT.reserve(vals.size());
-
     TA_Integer outBeg;
     TA_Integer outNbElement;
-    TA_RetCode retCode;
-    TA_Real out_val[vals.size()];
-
-    int min_idx = 0;
-    int max_idx = vals.size() - 1;
-
-    retCode = TA_S_SMA(min_idx, max_idx,
-                       &vals[0],
-                       period,
-                       &outBeg,
-                       &outNbElement,
-                       &out_val[0]);
-
-    for (int ii = 0; ii < outBeg; ii++)
-    {
-        OUT.push_back(0.0);
-    }
+    TA_Real *out_val = talib_scratch(nb);
 
-    for (int ii = 0; ii < outNbElement; ii++)
-    {
-        OUT.push_back(out_val[ii]);
-    }
+    TA_S_SMA(0, nb - 1,
+             vals,
+             period,
+             &outBeg,
+             &outNbElement,
+             out_val);
 
-    if (OUT.size() != vals.size())
-        abort();
+    copy_talib_output(out_val, outBeg, outNbElement, nb, out);
+}
 
+std::vector<float> TALIB_SMA(const std::vector<float> &vals, const int period)
+{
+    std::vector<float> OUT(vals.size());
+    TALIB_SMA(vals.data(), vals.size(), period, OUT.data());
     return OUT;
 }
 //////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
-std::vector<float> TALIB_ATR(const std::vector<float> &high, const std::vector<float> &low, const std::vector<float> &close, const int period)
+void TALIB_ATR(const float *high, const float *low, const float *close, const uint nb, const int period, float *out)
 {
-    std::vector<float> OUT;
-    OUT.reserve(high.size());
-
     TA_Integer outBeg;
     TA_Integer outNbElement;
-    TA_RetCode retCode;
-    TA_Real out_val[high.size()];
+    TA_Real *out_val = talib_scratch(nb);
 
-    int min_idx = 0;
-    int max_idx = high.size() - 1;
+    TA_S_ATR(0, nb - 1,
+             high, low, close,
+             period,
+             &outBeg,
+             &outNbElement,
+             out_val);
 
-    retCode = TA_S_ATR(min_idx, max_idx,
-                       &high[0], &low[0], &close[0],
-                       period,
-                       &outBeg,
-                       &outNbElement,
-                       &out_val[0]);
+    copy_talib_output(out_val, outBeg, outNbElement, nb, out);
+}
 
-    for (int ii = 0; ii < outBeg; ii++)
-    {
-        OUT.push_back(0.0);
-    }
+std::vector<float> TALIB_ATR(const std::vector<float> &high, const std::vector<float> &low, const std::vector<float> &close, const int period)
+{
+    if (low.size() != high.size() || close.size() != high.size())
+        abort();
+    std::vector<float> OUT(high.size());
+    TALIB_ATR(high.data(), low.data(), close.data(), high.size(), period, OUT.data());
+    return OUT;
+}
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
-    for (int ii = 0; ii < outNbElement; ii++)
+// van Herk / Gil-Werman: the bars are cut in blocks of window bars. prefix[i] is the extremum from the start of the
+// block of i to i, suffix[i] the one from i to the end of its block, and the last window bars ending at i straddle at
+// most two blocks: their extremum is the one of suffix[i + 1 - window] and prefix[i]
+template <typename BEFORE>
+static void rolling_extremum(const float *vals, const uint nb, const std::vector<int> &windows, float *const *out, const BEFORE before)
+{
+    std::vector<float> prefix(nb), suffix(nb);
+    for (size_t j = 0; j < windows.size(); j++)
     {
-        OUT.push_back(out_val[ii]);
+        const uint window = windows[j];
+        if (window > nb)
+        {
+            std::fill(out[j], out[j] + nb, 0.0f);
+            continue;
+        }
+        for (uint start = 0; start < nb; start += window)
+        {
+            const uint end = std::min(start + window, nb);
+            prefix[start] = vals[start];
+            for (uint i = start + 1; i < end; i++)
+                prefix[i] = before(vals[i], prefix[i - 1]) ? vals[i] : prefix[i - 1];
+            suffix[end - 1] = vals[end - 1];
+            for (uint i = end - 1; i > start; i--)
+                suffix[i - 1] = before(vals[i - 1], suffix[i]) ? vals[i - 1] : suffix[i];
+        }
+
+        std::fill(out[j], out[j] + window - 1, 0.0f);
+        for (uint i = window - 1; i < nb; i++)
+        {
+            const float first = suffix[i + 1 - window], last = prefix[i];
+            out[j][i] = before(last, first) ? last : first;
+        }
     }
+}
 
-    if (OUT.size() != high.size() || OUT.size() != low.size() || OUT.size() != close.size())
-        abort();
+void ROLLING_MIN(const float *vals, const uint nb, const std::vector<int> &windows, float *const *out)
+{
+    if (windows.size() == 1)
+        return TALIB_MIN(vals, nb, windows[0], out[0]);
+    rolling_extremum(vals, nb, windows, out, [](const float a, const float b) { return a < b; });
+}
 
-    return OUT;
+void ROLLING_MAX(const float *vals, const uint nb, const std::vector<int> &windows, float *const *out)
+{
+    if (windows.size() == 1)
+        return TALIB_MAX(vals, nb, windows[0], out[0]);
+    rolling_extremum(vals, nb, windows, out, [](const float a, const float b) { return a > b; });
 }
-//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
-std::vector<float> TALIB_STOCHRSI_not_averaged(const std::vector<float> &vals, const int nb_period_stoch, const int nb_period_rsi)
+
+// the highest high and the lowest low over each window
+struct ROLLING_RANGES
 {
-    std::vector<float> stochrsi{};
-    stochrsi.reserve(vals.size());
-    // lowest_rsi = rsi.rolling(length).min()
-    // highest_rsi = rsi.rolling(length).max()
-    // stochrsi = (rsi - lowest_rsi) / (highest_rsi - lowest_rsi)
-    std::vector<float> rsi = TALIB_RSI(vals, nb_period_rsi);
-    // std::cout << "Calculated RSI." << std::endl;
-    std::vector<float> highest_rsi = TALIB_MAX(rsi, nb_period_stoch);
-    std::vector<float> lowest_rsi = TALIB_MIN(rsi, nb_period_stoch);
+    std::vector<std::vector<float>> highest;
+    std::vector<std::vector<float>> lowest;
 
-    for (uint i = 0; i < rsi.size(); i++)
+    ROLLING_RANGES(const float *high, const float *low, const uint nb, const std::vector<int> &windows)
+        : highest(windows.size(), std::vector<float>(nb)), lowest(windows.size(), std::vector<float>(nb))
     {
-        float val = (rsi[i] - lowest_rsi[i]) / (highest_rsi[i] - lowest_rsi[i]);
-        if (std::isnan(val) | std::isinf(val))
+        std::vector<float *> highest_out, lowest_out;
+        for (size_t j = 0; j < windows.size(); j++)
         {
-            val = 0.0;
+            highest_out.push_back(highest[j].data());
+            lowest_out.push_back(lowest[j].data());
         }
-        stochrsi.push_back(std::round(val * 1000.0) / 1000.0);
+        ROLLING_MAX(high, nb, windows, highest_out.data());
+        ROLLING_MIN(low, nb, windows, lowest_out.data());
     }
+};
 
-    return stochrsi;
-}
-//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
-std::vector<float> TALIB_STOCHRSI_K(const std::vector<float> &vals, const int nb_period_stoch, const int nb_period_rsi, const int nb_period_k, const int nb_period_d)
+void STOCHRSI_BATCH(const float *rsi, const uint nb, const std::vector<int> &windows, float *const *out)
 {
-    std::vector<float> stochrsi{};
-    stochrsi.reserve(vals.size());
     // lowest_rsi = rsi.rolling(length).min()
     // highest_rsi = rsi.rolling(length).max()
     // stochrsi = (rsi - lowest_rsi) / (highest_rsi - lowest_rsi)
-    std::vector<float> rsi = TALIB_RSI(vals, nb_period_rsi);
-    // std::cout << "Calculated RSI." << std::endl;
-    std::vector<float> highest_rsi = TALIB_MAX(rsi, nb_period_stoch);
-    std::vector<float> lowest_rsi = TALIB_MIN(rsi, nb_period_stoch);
+    const ROLLING_RANGES rsi_range(rsi, rsi, nb, windows);
+    std::vector<float> rsi_values(rsi, rsi + nb); // out may alias rsi
 
-    for (uint i = 0; i < rsi.size(); i++)
+    for (size_t j = 0; j < windows.size(); j++)
     {
-        float val = (rsi[i] - lowest_rsi[i]) / (highest_rsi[i] - lowest_rsi[i]);
-        if (std::isnan(val) | std::isinf(val))
+        const float *highest_rsi = rsi_range.highest[j].data();
+        const float *lowest_rsi = rsi_range.lowest[j].data();
+        for (uint i = 0; i < nb; i++)
         {
-            val = 0.0;
+            float val = (rsi_values[i] - lowest_rsi[i]) / (highest_rsi[i] - lowest_rsi[i]);
+            if (std::isnan(val) | std::isinf(val))
+            {
+                val = 0.0;
+            }
+            out[j][i] = std::round(val * 1000.0) / 1000.0;
         }
-        stochrsi.push_back(std::round(val * 1000.0) / 1000.0);
     }
-
-    return TALIB_SMA(stochrsi, nb_period_k);
 }
 
-//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
-std::vector<float> TALIB_STOCHRSI_D(const std::vector<float> &vals, const int nb_period_stoch, const int nb_period_rsi, const int nb_period_k, const int nb_period_d)
+void WILLR_BATCH(const float *high, const float *low, const float *close, const uint nb, const std::vector<int> &lengths, float *const *out)
 {
-    std::vector<float> stochrsi{};
-    stochrsi.reserve(vals.size());
-    // lowest_rsi = rsi.rolling(length).min()
-    // highest_rsi = rsi.rolling(length).max()
-    // stochrsi = (rsi - lowest_rsi) / (highest_rsi - lowest_rsi)
-    std::vector<float> rsi = TALIB_RSI(vals, nb_period_rsi);
-    // std::cout << "Calculated RSI." << std::endl;
-    std::vector<float> highest_rsi = TALIB_MAX(rsi, nb_period_stoch);
-    std::vector<float> lowest_rsi = TALIB_MIN(rsi, nb_period_stoch);
+    if (lengths.size() == 1)
+        return TALIB_WILLR(high, low, close, nb, lengths[0], out[0]);
+
+    // same arithmetic as TA-lib, in double
+    const ROLLING_RANGES range(high, low, nb, lengths);
 
-    for (uint i = 0; i < rsi.size(); i++)
+    for (size_t j = 0; j < lengths.size(); j++)
     {
-        float val = (rsi[i] - lowest_rsi[i]) / (highest_rsi[i] - lowest_rsi[i]);
-        if (std::isnan(val) | std::isinf(val))
+        const uint first = lengths[j] - 1;
+        for (uint i = 0; i < nb; i++)
         {
-            val = 0.0;
+            const double highest = range.highest[j][i];
+            const double diff = (highest - range.lowest[j][i]) / (-100.0);
+            out[j][i] = i < first || diff == 0.0 ? 0.0 : (highest - close[i]) / diff;
         }
-        stochrsi.push_back(std::round(val * 1000.0) / 1000.0);
     }
-
-    return TALIB_SMA(TALIB_SMA(stochrsi, nb_period_k), nb_period_d);
 }
 
 //////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+void TALIB_STOCHRSI_from_rsi(const float *rsi, const uint nb, const int nb_period_stoch, float *out)
+{
+    STOCHRSI_BATCH(rsi, nb, {nb_period_stoch}, &out);
+}
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+std::vector<float> TALIB_STOCHRSI_not_averaged(const std::vector<float> &vals, const int nb_period_stoch, const int nb_period_rsi)
+{
+    std::vector<float> stochrsi = TALIB_RSI(vals, nb_period_rsi);
+    TALIB_STOCHRSI_from_rsi(stochrsi.data(), stochrsi.size(), nb_period_stoch, stochrsi.data());
+    return stochrsi;
+}
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+std::vector<float> TALIB_STOCHRSI_K(const std::vector<float> &vals, const int nb_period_stoch, const int nb_period_rsi, const int nb_period_k, const int nb_period_d)
+{
+    return TALIB_SMA(TALIB_STOCHRSI_not_averaged(vals, nb_period_stoch, nb_period_rsi), nb_period_k);
+}
 
-std::vector<float> TALIB_TRIX(const std::vector<float> &vals, const int trixLength, const int trixSignal)
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+std::vector<float> TALIB_STOCHRSI_D(const std::vector<float> &vals, const int nb_period_stoch, const int nb_period_rsi, const int nb_period_k, const int nb_period_d)
 {
-    std::vector<float> TRIX;
-    std::vector<float> TRIX_PCT;
-    std::vector<float> TRIX_SIGNAL;
-    std::vector<float> TRIX_HISTO;
+    return TALIB_SMA(TALIB_STOCHRSI_K(vals, nb_period_stoch, nb_period_rsi, nb_period_k, nb_period_d), nb_period_d);
+}
 
-    TRIX = TALIB_EMA(vals, trixLength);
-    TRIX = TALIB_EMA(TRIX, trixLength);
-    TRIX = TALIB_EMA(TRIX, trixLength);
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
-    TRIX_PCT.reserve(vals.size());
-    TRIX_HISTO.reserve(vals.size());
+void TALIB_TRIPLE_EMA(const float *vals, const uint nb, const int trixLength, float *out)
+{
+    TALIB_EMA(vals, nb, trixLength, out);
+    TALIB_EMA(out, nb, trixLength, out);
+    TALIB_EMA(out, nb, trixLength, out);
+}
 
-    TRIX_PCT.push_back(0.0);
-    for (uint i = 1; i < TRIX.size(); i++)
+void TALIB_TRIX_PCT(const float *TRIX, const uint nb, float *out)
+{
+    if (nb == 0)
+        return;
+    // backwards, so that out may alias TRIX
+    for (uint i = nb - 1; i > 0; i--)
     {
         float val = (TRIX[i] - TRIX[i - 1]) / TRIX[i - 1] * 100.0;
         if (std::isinf(val) | std::isnan(val))
         {
             val = 0.0;
         }
-        TRIX_PCT.push_back(val);
+        out[i] = val;
     }
+    out[0] = 0.0;
+}
 
-    if (TRIX_PCT.size() != TRIX.size())
+void TALIB_TRIX_from_pct(const float *TRIX_PCT, const uint nb, const int trixSignal, float *out)
+{
+    // histogram = pct - SMA(pct, trixSignal) in one pass. The window sum is kept the way TA_SMA keeps it (add the new
+    // value, then drop the trailing one), so the signal has the TALIB_SMA values
+    const uint first = trixSignal - 1;
+    double period_total = 0.0;
+    for (uint i = 0; i < nb; i++)
     {
-        std::cout << "ERROR TRIX_PCT.size()!=TRIX.size()" << std::endl;
-        std::abort();
+        period_total += TRIX_PCT[i];
+        if (i < first)
+        {
+            out[i] = TRIX_PCT[i];
+            continue;
+        }
+        const float signal = period_total / trixSignal;
+        period_total -= TRIX_PCT[i - first];
+        out[i] = TRIX_PCT[i] - signal;
     }
+}
 
-    TRIX_SIGNAL = TALIB_SMA(TRIX_PCT, trixSignal);
-
-    for (uint i = 0; i < TRIX_PCT.size(); i++)
-    {
-        TRIX_HISTO.push_back(TRIX_PCT[i] - TRIX_SIGNAL[i]);
-    }
+void TALIB_TRIX_from_triple_ema(const float *TRIX, const uint nb, const int trixSignal, float *out)
+{
+    std::vector<float> TRIX_PCT(nb);
+    TALIB_TRIX_PCT(TRIX, nb, TRIX_PCT.data());
+    TALIB_TRIX_from_pct(TRIX_PCT.data(), nb, trixSignal, out);
+}
 
+std::vector<float> TALIB_TRIX(const std::vector<float> &vals, const int trixLength, const int trixSignal)
+{
+    std::vector<float> TRIX_HISTO(vals.size());
+    TALIB_TRIPLE_EMA(vals.data(), vals.size(), trixLength, TRIX_HISTO.data());
+    const std::vector<float> TRIX = TRIX_HISTO;
+    TALIB_TRIX_from_triple_ema(TRIX.data(), TRIX.size(), trixSignal, TRIX_HISTO.data());
     return TRIX_HISTO;
 }
 
 //////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
-SuperTrend TALIB_SuperTrend(const std::vector<float> &high, const std::vector<float> &low, const std::vector<float> &close,
-                            const int atr_window, const int atr_multi)
-{
-    vector<float> hl2{};
-    vector<float> upperband{};
-    vector<float> lowerband{};
-    vector<int> dir{};
-    vector<float> trend{};
-    vector<float> longg{};
-    vector<float> shortt{};
-    vector<float> matr{};
-    hl2.reserve(high.size());
-    upperband.reserve(high.size());
-    lowerband.reserve(high.size());
-    dir.reserve(high.size());
-    trend.reserve(high.size());
-    longg.reserve(high.size());
-    shortt.reserve(high.size());
-    matr.reserve(high.size());
-
-    const vector<float> ATR = TALIB_ATR(high, low, close, atr_window);
 
-    const uint m = close.size();
-
-    for (uint ii = 0; ii < m; ii++)
+// TA-lib's TRANGE in double: tr[0] is left unset, the first bar has no previous close
+static void true_range(const float *high, const float *low, const float *close, const uint nb, double *tr)
+{
+    for (uint i = 1; i < nb; i++)
     {
-        dir.push_back(1);
-        trend.push_back(0.0);
-        longg.push_back(NAN);
-        shortt.push_back(NAN);
+        const double high_i = high[i];
+        const double low_i = low[i];
+        const double prev_close = close[i - 1];
+        double greatest = high_i - low_i;
+        greatest = std::max(greatest, std::fabs(prev_close - high_i));
+        greatest = std::max(greatest, std::fabs(low_i - prev_close));
+        tr[i] = greatest;
     }
+}
 
-    for (uint ii = 0; ii < m; ii++)
+// TA-lib's ATR from the true range: the SMA of the first window values, then Wilder's smoothing
+static void atr_from_true_range(const double *tr, const uint nb, const int window, float *out)
+{
+    const uint first = window <= 1 ? 1 : window;
+    std::fill(out, out + std::min(first, nb), 0.0f);
+    if (first >= nb)
+        return;
+    if (window <= 1)
     {
-        // HL2 is the average of high and low prices
-        hl2.push_back((high[ii] + low[ii]) / 2.0f);
-        matr.push_back(float(atr_multi) * ATR[ii]);
-        upperband.push_back(hl2.back() + matr.back());
-        lowerband.push_back(hl2.back() - matr.back());
+        for (uint i = 1; i < nb; i++)
+            out[i] = tr[i];
+        return;
     }
 
-    for (uint ii = 1; ii < m; ii++)
+    double atr = 0.0;
+    for (uint i = 1; i <= first; i++)
+        atr += tr[i];
+    atr /= window;
+    out[first] = atr;
+    for (uint i = first + 1; i < nb; i++)
     {
-        if (close[ii] > upperband[ii - 1])
-        {
-            dir[ii] = 1;
-        }
-        else if (close[ii] < lowerband[ii - 1])
-        {
-            dir[ii] = -1;
-        }
-        else
-        {
-            dir[ii] = dir[ii - 1];
-            if (dir[ii] > 0 && lowerband[ii] < lowerband[ii - 1])
-            {
-                lowerband[ii] = lowerband[ii - 1];
-            }
-            if (dir[ii] < 0 && upperband[ii] > upperband[ii - 1])
-            {
-                upperband[ii] = upperband[ii - 1];
-            }
-        }
-
-        if (dir[ii] > 0)
-        {
-            trend[ii] = lowerband[ii];
-            longg[ii] = lowerband[ii];
-        }
-        else
-        {
-            trend[ii] = upperband[ii];
-            shortt[ii] = upperband[ii];
-        }
+        atr *= window - 1;
+        atr += tr[i];
+        atr /= window;
+        out[i] = atr;
     }
-
-    return {dir, lowerband, upperband};
 }
 
-//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
-std::vector<float> TALIB_SuperTrend_dir_only(const std::vector<float> &high, const std::vector<float> &low, const std::vector<float> &close,
-                                             const int atr_window, const int atr_multi)
-{
-    vector<float> hl2{};
-    vector<float> upperband{};
-    vector<float> lowerband{};
-    vector<float> dir{};
-    vector<float> trend{};
-    vector<float> longg{};
-    vector<float> shortt{};
-    vector<float> matr{};
-    hl2.reserve(high.size());
-    upperband.reserve(high.size());
-    lowerband.reserve(high.size());
-    dir.reserve(high.size());
-    trend.reserve(high.size());
-    longg.reserve(high.size());
-    shortt.reserve(high.size());
-    matr.reserve(high.size());
-
-    const vector<float> ATR = TALIB_ATR(high, low, close, atr_window);
-
-    const uint m = close.size();
-
-    for (uint ii = 0; ii < m; ii++)
+void ATR_BATCH(const float *high, const float *low, const float *close, const uint nb, const std::vector<int> &windows, float *const *out)
+{
+    std::vector<double> tr(nb);
+    true_range(high, low, close, nb, tr.data());
+    for (size_t j = 0; j < windows.size(); j++)
     {
-        dir.push_back(1.0);
-        trend.push_back(0.0);
-        longg.push_back(NAN);
-        shortt.push_back(NAN);
+        atr_from_true_range(tr.data(), nb, windows[j], out[j]);
     }
+}
 
-    for (uint ii = 0; ii < m; ii++)
+void SUPERTREND_DIRECTION(const float *high, const float *low, const float *close, const float *atr, const uint nb,
+                          const float multiplier, float *dir, float *lowerband, float *upperband)
+{
+    if (nb == 0)
+        return;
+
+    // only the previous bands are needed, the band arrays are written when asked for
+    float direction = 1.0f;
+    float hl2 = (high[0] + low[0]) / 2.0f;
+    float upper = hl2 + multiplier * atr[0];
+    float lower = hl2 - multiplier * atr[0];
+    dir[0] = direction;
+    if (lowerband != nullptr)
     {
-        // HL2 is the average of high and low prices
-        hl2.push_back((high[ii] + low[ii]) / 2.0f);
-        matr.push_back(float(atr_multi) * ATR[ii]);
-        upperband.push_back(hl2.back() + matr.back());
-        lowerband.push_back(hl2.back() - matr.back());
+        lowerband[0] = lower;
+        upperband[0] = upper;
     }
 
-    for (uint ii = 1; ii < m; ii++)
+    for (uint ii = 1; ii < nb; ii++)
     {
-        if (close[ii] > upperband[ii - 1])
+        // HL2 is the average of high and low prices
+        hl2 = (high[ii] + low[ii]) / 2.0f;
+        const float matr = multiplier * atr[ii];
+        float upper_ii = hl2 + matr;
+        float lower_ii = hl2 - matr;
+
+        if (close[ii] > upper)
         {
-            dir[ii] = 1;
+            direction = 1.0f;
         }
-        else if (close[ii] < lowerband[ii - 1])
+        else if (close[ii] < lower)
         {
-            dir[ii] = -1;
+            direction = -1.0f;
         }
         else
         {
-            dir[ii] = dir[ii - 1];
-            if (dir[ii] > 0 && lowerband[ii] < lowerband[ii - 1])
+            if (direction > 0.0f && lower_ii < lower)
             {
-                lowerband[ii] = lowerband[ii - 1];
+                lower_ii = lower;
             }
-            if (dir[ii] < 0 && upperband[ii] > upperband[ii - 1])
+            if (direction < 0.0f && upper_ii > upper)
             {
-                upperband[ii] = upperband[ii - 1];
+                upper_ii = upper;
             }
         }
 
-        if (dir[ii] > 0)
+        upper = upper_ii;
+        lower = lower_ii;
+        dir[ii] = direction;
+        if (lowerband != nullptr)
         {
-            trend[ii] = lowerband[ii];
-            longg[ii] = lowerband[ii];
+            lowerband[ii] = lower;
+            upperband[ii] = upper;
         }
-        else
+    }
+}
+
+// the direction of each (atr_windows[j], multipliers[j]) pair, the true range is computed once and each ATR once
+static void supertrend_directions(const float *high, const float *low, const float *close, const uint nb,
+                                  const std::vector<int> &atr_windows, const std::vector<float> &multipliers, float *const *out)
+{
+    std::vector<double> tr(nb);
+    true_range(high, low, close, nb, tr.data());
+    std::vector<float> atr(nb);
+    std::vector<bool> done(atr_windows.size(), false);
+    for (size_t first = 0; first < atr_windows.size(); first++)
+    {
+        if (done[first])
+            continue;
+        atr_from_true_range(tr.data(), nb, atr_windows[first], atr.data());
+        for (size_t j = first; j < atr_windows.size(); j++)
+        {
+            if (atr_windows[j] != atr_windows[first])
+                continue;
+            done[j] = true;
+            SUPERTREND_DIRECTION(high, low, close, atr.data(), nb, multipliers[j], out[j], nullptr, nullptr);
+        }
+    }
+}
+
+void SUPERTREND_BATCH(const float *high, const float *low, const float *close, const uint nb,
+                      const std::vector<int> &atr_windows, const std::vector<float> &multipliers, float *const *out)
+{
+    std::vector<int> pair_windows;
+    std::vector<float> pair_multipliers;
+    for (const int window : atr_windows)
+    {
+        for (const float multiplier : multipliers)
         {
-            trend[ii] = upperband[ii];
-            shortt[ii] = upperband[ii];
+            pair_windows.push_back(window);
+            pair_multipliers.push_back(multiplier);
         }
     }
+    supertrend_directions(high, low, close, nb, pair_windows, pair_multipliers, out);
+}
+
+SuperTrend TALIB_SuperTrend(const std::vector<float> &high, const std::vector<float> &low, const std::vector<float> &close,
+                            const int atr_window, const float atr_multi)
+{
+    const uint m = close.size();
+    std::vector<float> ATR(m);
+    float *atr = ATR.data();
+    ATR_BATCH(high.data(), low.data(), close.data(), m, {atr_window}, &atr);
+
+    SuperTrend st{std::vector<int>(m), std::vector<float>(m), std::vector<float>(m)};
+    std::vector<float> dir(m);
+    SUPERTREND_DIRECTION(high.data(), low.data(), close.data(), ATR.data(), m, atr_multi,
+                         dir.data(), st.final_lowerband.data(), st.final_upperband.data());
+    std::copy(dir.begin(), dir.end(), st.supertrend.begin());
+    return st;
+}
 
+std::vector<float> TALIB_SuperTrend_dir_only(const std::vector<float> &high, const std::vector<float> &low, const std::vector<float> &close,
+                                             const int atr_window, const float atr_multi)
+{
+    std::vector<float> dir(close.size());
+    float *out = dir.data();
+    SUPERTREND_BATCH(high.data(), low.data(), close.data(), close.size(), {atr_window}, {atr_multi}, &out);
     return dir;
 }
 
@@ -516,8 +652,15 @@ void swap(int *first, int *second)
 
 //////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
-std::vector<float> TALIB_AO(const std::vector<float> &high, const std::vector<float> &low,
-                            const int fast, const int slow)
+void TALIB_MEDIAN_PRICE(const float *high, const float *low, const uint nb, float *out)
+{
+    for (uint ii = 0; ii < nb; ii++)
+    {
+        out[ii] = 0.5f * (high[ii] + low[ii]);
+    }
+}
+
+void TALIB_AO_from_median_price(const float *median_price, const uint nb, const int fast, const int slow, float *out)
 {
     int fastt = fast;
     int sloww = slow;
@@ -526,66 +669,275 @@ std::vector<float> TALIB_AO(const std::vector<float> &high, const std::vector<fl
         swap(&fastt, &sloww);
     }
 
-    const uint m = high.size();
-
-    vector<float> median_price{};
-    vector<float> fast_sma{};
-    vector<float> slow_sma{};
-    vector<float> ao{};
-    median_price.reserve(m);
-    ao.reserve(m);
+    // out = fast SMA, then AO
+    std::vector<float> slow_sma(nb);
+    TALIB_SMA(median_price, nb, fastt, out);
+    TALIB_SMA(median_price, nb, sloww, slow_sma.data());
+    for (uint ii = 0; ii < nb; ii++)
+    {
+        out[ii] = out[ii] - slow_sma[ii];
+    }
+}
 
-    for (uint ii = 0; ii < m; ii++)
+PREFIX_SUM_SMA::PREFIX_SUM_SMA(const float *vals, const uint nb) : sums(nb + 1)
+{
+    sums[0] = 0.0;
+    for (uint i = 0; i < nb; i++)
     {
-        median_price.push_back(0.5f * (high[ii] + low[ii]));
+        sums[i + 1] = sums[i] + vals[i];
     }
+}
 
-    fast_sma = TALIB_SMA(median_price, fastt);
-    slow_sma = TALIB_SMA(median_price, sloww);
-    for (uint ii = 0; ii < m; ii++)
+void PREFIX_SUM_SMA::ao(const int fast, const int slow, float *out) const
+{
+    const uint nb = sums.size() - 1;
+    const int fastt = std::min(fast, slow);
+    const int sloww = std::max(fast, slow);
+    for (uint i = 0; i < nb; i++)
     {
-        ao.push_back(fast_sma[ii] - slow_sma[ii]);
+        out[i] = sma(i, fastt) - sma(i, sloww);
     }
+}
 
+std::vector<float> TALIB_AO(const std::vector<float> &high, const std::vector<float> &low,
+                            const int fast, const int slow)
+{
+    std::vector<float> ao(high.size());
+    TALIB_MEDIAN_PRICE(high.data(), low.data(), high.size(), ao.data());
+    const std::vector<float> median_price = ao;
+    TALIB_AO_from_median_price(median_price.data(), median_price.size(), fast, slow, ao.data());
     return ao;
 }
 
 //////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
-std::vector<float> TALIB_WILLR(const std::vector<float> &high, const std::vector<float> &low, const std::vector<float> &close,
-                               const int length)
+void TALIB_WILLR(const float *high, const float *low, const float *close, const uint nb, const int length, float *out)
 {
-    std::vector<float> OUT;
-    OUT.reserve(high.size());
-
     TA_Integer outBeg;
     TA_Integer outNbElement;
-    TA_RetCode retCode;
-    TA_Real out_val[high.size()];
+    TA_Real *out_val = talib_scratch(nb);
+
+    TA_S_WILLR(0, nb - 1,
+               high, low, close,
+               length,
+               &outBeg,
+               &outNbElement,
+               out_val);
 
-    int min_idx = 0;
-    int max_idx = high.size() - 1;
+    copy_talib_output(out_val, outBeg, outNbElement, nb, out);
+}
 
-    retCode = TA_S_WILLR(min_idx, max_idx,
-                         &high[0], &low[0], &close[0],
-                         length,
-                         &outBeg,
-                         &outNbElement,
-                         &out_val[0]);
+std::vector<float> TALIB_WILLR(const std::vector<float> &high, const std::vector<float> &low, const std::vector<float> &close, const int length)
+{
+    if (low.size() != high.size() || close.size() != high.size())
+        abort();
+    std::vector<float> OUT(high.size());
+    TALIB_WILLR(high.data(), low.data(), close.data(), high.size(), length, OUT.data());
+    return OUT;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+float STREAM_SMA::update(const float val)
+{
+    // TA_SMA's running total: add the new value, divide, then drop the oldest value of the window
+    window[nb % period] = val;
+    total += val;
+    nb++;
+    if (nb < uint(period))
+        return 0.0f;
+    const float sma = total / period;
+    total -= window[nb % period];
+    return sma;
+}
 
-    for (int ii = 0; ii < outBeg; ii++)
+float STREAM_EMA::update(const float val)
+{
+    nb++;
+    if (nb < uint(period))
+    {
+        ema += val;
+        return 0.0f;
+    }
+    if (nb == uint(period))
     {
-        OUT.push_back(0.0);
+        // seeded with the SMA of the first period values
+        ema += val;
+        ema /= period;
+        return ema;
     }
+    ema = (val - ema) * k + ema;
+    return ema;
+}
 
-    for (int ii = 0; ii < outNbElement; ii++)
+float STREAM_RSI::update(const float val)
+{
+    const uint i = nb++;
+    const double diff = val - prev_value;
+    prev_value = val;
+    if (i == 0)
+        return 0.0f;
+
+    if (i <= uint(period))
+    {
+        // averages of the first period gains and losses
+        if (diff < 0)
+            loss -= diff;
+        else
+            gain += diff;
+        if (i < uint(period))
+            return 0.0f;
+        loss /= period;
+        gain /= period;
+    }
+    else
     {
-        OUT.push_back(out_val[ii]);
+        // then Wilder's smoothing
+        loss *= (period - 1);
+        gain *= (period - 1);
+        if (diff < 0)
+            loss -= diff;
+        else
+            gain += diff;
+        loss /= period;
+        gain /= period;
     }
 
-    if (OUT.size() != high.size() || OUT.size() != low.size() || OUT.size() != close.size())
-        abort();
+    // TA_IS_ZERO
+    const double sum = gain + loss;
+    if (-0.00000001 < sum && sum < 0.00000001)
+        return 0.0f;
+    return 100.0 * (gain / sum);
+}
 
-    return OUT;
+float STREAM_ATR::update(const float high, const float low, const float close)
+{
+    const uint i = nb++;
+    const double high_i = high;
+    const double low_i = low;
+    double tr = high_i - low_i;
+    tr = std::max(tr, std::fabs(prev_close - high_i));
+    tr = std::max(tr, std::fabs(low_i - prev_close));
+    prev_close = close;
+    if (i == 0)
+        return 0.0f;
+    if (period <= 1)
+        return tr;
+
+    if (i < uint(period))
+    {
+        atr += tr;
+        return 0.0f;
+    }
+    if (i == uint(period))
+    {
+        atr += tr;
+        atr /= period;
+        return atr;
+    }
+    atr *= period - 1;
+    atr += tr;
+    atr /= period;
+    return atr;
+}
+
+float STREAM_EXTREMUM::update(const float val)
+{
+    const uint i = nb++;
+    // the front leaves the window first, so that the ring never holds more than period candidates
+    if (size > 0 && bars[head] + period <= i)
+    {
+        head = (head + 1) % period;
+        size--;
+    }
+    // candidates dominated by the new value are dropped from the back
+    while (size > 0)
+    {
+        const float back = values[(head + size - 1) % period];
+        if (maximum ? back > val : back < val)
+            break;
+        size--;
+    }
+    const uint slot = (head + size) % period;
+    bars[slot] = i;
+    values[slot] = val;
+    size++;
+
+    if (i + 1 < uint(period))
+        return 0.0f;
+    return values[head];
+}
+
+float STREAM_STOCHRSI::update(const float val)
+{
+    const float rsi_i = rsi.update(val);
+    const float highest_rsi = highest.update(rsi_i);
+    const float lowest_rsi = lowest.update(rsi_i);
+    float stochrsi = (rsi_i - lowest_rsi) / (highest_rsi - lowest_rsi);
+    if (std::isnan(stochrsi) | std::isinf(stochrsi))
+    {
+        stochrsi = 0.0;
+    }
+    return std::round(stochrsi * 1000.0) / 1000.0;
+}
+
+float STREAM_TRIX::update(const float val)
+{
+    const float triple = ema3.update(ema2.update(ema1.update(val)));
+    float pct = 0.0f;
+    if (nb++ > 0)
+    {
+        pct = (triple - prev_triple) / prev_triple * 100.0;
+        if (std::isinf(pct) | std::isnan(pct))
+        {
+            pct = 0.0;
+        }
+    }
+    prev_triple = triple;
+    // the signal is 0 during its warm-up, where the histogram is the percent change
+    return pct - signal.update(pct);
+}
+
+float STREAM_SUPERTREND::update(const float high, const float low, const float close)
+{
+    const float hl2 = (high + low) / 2.0f;
+    const float matr = multiplier * atr.update(high, low, close);
+    float upper = hl2 + matr;
+    float lower = hl2 - matr;
+
+    if (nb++ > 0)
+    {
+        if (close > upperband)
+        {
+            direction = 1.0f;
+        }
+        else if (close < lowerband)
+        {
+            direction = -1.0f;
+        }
+        else
+        {
+            if (direction > 0.0f && lower < lowerband)
+            {
+                lower = lowerband;
+            }
+            if (direction < 0.0f && upper > upperband)
+            {
+                upper = upperband;
+            }
+        }
+    }
+    upperband = upper;
+    lowerband = lower;
+    return direction;
+}
+
+float STREAM_WILLR::update(const float high, const float low, const float close)
+{
+    const double highest_high = highest.update(high);
+    const double diff = (highest_high - lowest.update(low)) / (-100.0);
+    if (nb++ + 1 < uint(highest.period) || diff == 0.0)
+        return 0.0f;
+    return (highest_high - close) / diff;
 }
 
 //////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -621,66 +973,880 @@ void RESAMPLE_TIMEFRAME(KLINEf &kline_in, KLINEf &kline_out, const int tf_in, co
         std::abort();
     }
 
-    const uint delta_T_sec = tf_out * 60;
-
-    const int nb_sampling = tf_in / tf_out;
+    // each bar of kline_out takes the values of the last kline_in bar opened at or before it, matched by
+    // timestamp so that the two timeframes may start at different times. Bars before the first kline_in bar get 0
+    std::vector<int> source(kline_out.nb, -1);
+    uint i = 0;
+    for (uint j = 0; j < kline_out.nb; j++)
+    {
+        while (i + 1 < kline_in.nb && kline_in.timestamp[i + 1] <= kline_out.timestamp[j])
+            i++;
+        if (kline_in.timestamp[i] <= kline_out.timestamp[j])
+            source[j] = i;
+    }
 
     // resample all indicators
     for (auto const &x : kline_in.indicators)
     {
-        std::vector<float> resampled{};
-        resampled.reserve(kline_in.nb * nb_sampling);
-        std::vector<uint> timestamp_list{};
-        // timestamp_list.reserve(kline_in.nb * nb_sampling);
-
-        // timestamp_list.push_back(kline_in.timestamp[0]);
+        std::vector<float> resampled(kline_out.nb, 0.0f);
+        for (uint j = 0; j < kline_out.nb; j++)
+        {
+            if (source[j] >= 0)
+                resampled[j] = x.second[source[j]];
+        }
 
-        for (int i = 0; i < kline_in.nb; i++)
+        if (tf_in == 60)
         {
-            const float val = x.second[i];
-            const std::vector<float> to_add(nb_sampling, val);
-            resampled.insert(resampled.end(), to_add.begin(), to_add.end());
+            kline_out.indicators[x.first + "_1h"] = resampled;
         }
+    }
 
-        // uint size_diff = timestamp_list.size() - kline_out.timestamp.size();
+    std::cout << "Done." << std::endl;
+}
 
-        // timestamp_list.resize(timestamp_list.size() - size_diff);
-        // resampled.resize(resampled.size() - size_diff);
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
-        // print_first_elements(timestamp_list, 10);
-        // print_first_elements(kline_out.timestamp, 10);
+INDICATOR_SPEC supertrend_dir_spec(const int atr_window, const float multiplier)
+{
+    const long tenths = std::lround(multiplier * 10.0f);
+    if (tenths <= 0 || std::fabs(tenths / 10.0f - multiplier) > 1e-4f * multiplier)
+    {
+        std::cout << "ERROR: SuperTrend multiplier must be a positive multiple of 0.1, got " << multiplier << std::endl;
+        std::abort();
+    }
+    return {IND_SUPERTREND_DIR, atr_window, int(tenths)};
+}
 
-        // print_last_elements(timestamp_list, 105);
-        // print_last_elements(kline_out.timestamp, 105);
+bool indicator_input(const INDICATOR_SPEC &spec, INDICATOR_SPEC &input)
+{
+    switch (spec.kind)
+    {
+    case IND_STOCHRSI:
+        input = {IND_RSI, spec.p2};
+        return true;
+    case IND_STOCHRSI_K:
+        input = {IND_STOCHRSI, spec.p1, spec.p2};
+        return true;
+    case IND_STOCHRSI_D:
+        input = {IND_STOCHRSI_K, spec.p1, spec.p2, spec.p3, spec.p4};
+        return true;
+    case IND_TRIX:
+        input = {IND_TRIX_PCT, spec.p1};
+        return true;
+    case IND_TRIX_PCT:
+        input = {IND_TRIPLE_EMA, spec.p1};
+        return true;
+    case IND_AO:
+        input = {IND_MEDIAN_PRICE};
+        return true;
+    default:
+        return false;
+    }
+}
+
+void compute_indicator(const KLINEf &kline, const INDICATOR_SPEC &spec, const float *input, float *out)
+{
+    const uint nb = kline.nb;
+    switch (spec.kind)
+    {
+    case IND_EMA:
+        return TALIB_EMA(kline.close.data(), nb, spec.p1, out);
+    case IND_SMA:
+        return TALIB_SMA(kline.close.data(), nb, spec.p1, out);
+    case IND_RSI:
+        return TALIB_RSI(kline.close.data(), nb, spec.p1, out);
+    case IND_ATR:
+        return TALIB_ATR(kline.high.data(), kline.low.data(), kline.close.data(), nb, spec.p1, out);
+    case IND_WILLR:
+        return TALIB_WILLR(kline.high.data(), kline.low.data(), kline.close.data(), nb, spec.p1, out);
+    case IND_STOCHRSI:
+        return TALIB_STOCHRSI_from_rsi(input, nb, spec.p1, out);
+    case IND_STOCHRSI_K:
+        return TALIB_SMA(input, nb, spec.p3, out);
+    case IND_STOCHRSI_D:
+        return TALIB_SMA(input, nb, spec.p4, out);
+    case IND_TRIX:
+        return TALIB_TRIX_from_pct(input, nb, spec.p2, out);
+    case IND_TRIX_PCT:
+        return TALIB_TRIX_PCT(input, nb, out);
+    case IND_AO:
+        return TALIB_AO_from_median_price(input, nb, spec.p1, spec.p2, out);
+    case IND_SUPERTREND_DIR:
+        return SUPERTREND_BATCH(kline.high.data(), kline.low.data(), kline.close.data(), nb, {spec.p1}, {supertrend_multiplier(spec)}, &out);
+    case IND_TRIPLE_EMA:
+        return TALIB_TRIPLE_EMA(kline.close.data(), nb, spec.p1, out);
+    case IND_MEDIAN_PRICE:
+        return TALIB_MEDIAN_PRICE(kline.high.data(), kline.low.data(), nb, out);
+    }
+    std::cout << "Unknown indicator kind " << int(spec.kind) << std::endl;
+    std::abort();
+}
+
+std::vector<float> compute_indicator(const KLINEf &kline, const INDICATOR_SPEC &spec)
+{
+    std::vector<float> values(kline.nb);
+    INDICATOR_SPEC input_spec;
+    if (indicator_input(spec, input_spec))
+    {
+        const std::vector<float> input = compute_indicator(kline, input_spec);
+        compute_indicator(kline, spec, input.data(), values.data());
+    }
+    else
+        compute_indicator(kline, spec, nullptr, values.data());
+    return values;
+}
 
-        // const uint last_idx = timestamp_list.size() - 1;
+bool same_indicator_batch(const INDICATOR_SPEC &a, const INDICATOR_SPEC &b)
+{
+    if (a.kind != b.kind)
+        return false;
+    switch (a.kind)
+    {
+    case IND_EMA:
+    case IND_WILLR:
+    case IND_SUPERTREND_DIR:
+        return true;
+    case IND_STOCHRSI:
+        return a.p2 == b.p2;
+    default:
+        return false;
+    }
+}
 
-        // if (resampled.size() != kline_out.nb)
-        //{
-        //     std::cout << "Incosistent size after resampling. Aborting" << std::endl;
-        //     std::cout << resampled.size() << " " << kline_out.nb << std::endl;
-        //     std::abort();
-        // }
+void compute_indicators(const KLINEf &kline, const std::vector<INDICATOR_SPEC> &specs, const float *input, float *const *out)
+{
+    std::vector<int> windows;
+    for (const INDICATOR_SPEC &spec : specs)
+    {
+        windows.push_back(spec.p1);
+    }
 
-        if (kline_in.timestamp[0] != kline_out.timestamp[0])
+    switch (specs[0].kind)
+    {
+    case IND_EMA:
+        return EMA_BATCH(kline.close, windows, out);
+    case IND_WILLR:
+        return WILLR_BATCH(kline.high.data(), kline.low.data(), kline.close.data(), kline.nb, windows, out);
+    case IND_STOCHRSI:
+        return STOCHRSI_BATCH(input, kline.nb, windows, out);
+    case IND_SUPERTREND_DIR:
+    {
+        std::vector<float> multipliers;
+        for (const INDICATOR_SPEC &spec : specs)
+        {
+            multipliers.push_back(supertrend_multiplier(spec));
+        }
+        return supertrend_directions(kline.high.data(), kline.low.data(), kline.close.data(), kline.nb, windows, multipliers, out);
+    }
+    default:
+        for (size_t j = 0; j < specs.size(); j++)
         {
-            std::cout << "Inconsistent first timestamp element. Aborting" << std::endl;
-            std::cout << kline_in.timestamp[0] << " " << kline_out.timestamp[0] << std::endl;
+            compute_indicator(kline, specs[j], input, out[j]);
+        }
+    }
+}
+
+// the inputs of other indicators: compacting them would also change the indicators derived from them
+static bool is_indicator_input(const INDICATOR_KIND kind)
+{
+    return kind == IND_RSI || kind == IND_STOCHRSI || kind == IND_STOCHRSI_K || kind == IND_TRIPLE_EMA || kind == IND_MEDIAN_PRICE ||
+           kind == IND_TRIX_PCT;
+}
+
+// 8 bits of kind and 14 bits per parameter
+uint64_t pack_indicator_spec(const INDICATOR_SPEC &spec)
+{
+    for (const int p : {spec.p1, spec.p2, spec.p3, spec.p4})
+    {
+        if (p < 0 || p >= (1 << 14))
+        {
+            std::cout << "Indicator parameter out of range: " << p << std::endl;
             std::abort();
         }
+    }
+    return uint64_t(spec.kind) << 56 | uint64_t(spec.p1) << 42 | uint64_t(spec.p2) << 28 | uint64_t(spec.p3) << 14 | uint64_t(spec.p4);
+}
 
-        // if (timestamp_list[last_idx] != kline_out.timestamp[last_idx])
-        // {
-        //     std::cout << "Incosistent last timestamp element. Aborting" << std::endl;
-        //     std::cout << timestamp_list[last_idx] << " " << kline_out.timestamp[last_idx] << std::endl;
-        //     std::abort();
-        // }
+// fp16 goes through the compiler's _Float16 (round to nearest even) after division by a power of 2, bf16 keeps the top
+// half of the float bits (rounded to nearest even), int16 is (x - base) / scale with -32768 reserved for an exact 0
+// (warm-up bars). With a reference, x is value / reference - 1 instead of the value, so that the side of the reference
+// is the sign of x, which every encoding keeps
+static const int16_t INT16_ZERO = INT16_MIN;
 
-        if (tf_in == 60)
+COMPACT_COLUMN encode_column(const std::vector<float> &values, const COLUMN_ENCODING encoding, const float *reference)
+{
+    COMPACT_COLUMN column;
+    column.encoding = encoding;
+    column.relative = reference != nullptr;
+    column.bits.resize(values.size());
+
+    std::vector<float> x(values);
+    if (column.relative)
+    {
+        for (size_t i = 0; i < x.size(); i++)
         {
-            kline_out.indicators[x.first + "_1h"] = resampled;
+            x[i] = values[i] / reference[i] - 1.0f; // 0 (warm-up) gives -1, decoded back to exactly 0
         }
     }
 
-    std::cout << "Done." << std::endl;
+    float lo = 0.0f, hi = 0.0f;
+    bool any = false;
+    for (size_t i = 0; i < x.size(); i++)
+    {
+        if (values[i] == 0.0f)
+            continue;
+        lo = any ? std::min(lo, x[i]) : x[i];
+        hi = any ? std::max(hi, x[i]) : x[i];
+        any = true;
+    }
+
+    if (encoding == ENC_FP16)
+    {
+        // |x| / scale <= 1, so that prices above 65504 do not overflow
+        column.scale = std::exp2(std::ceil(std::log2(std::max({std::fabs(lo), std::fabs(hi), 1e-30f}))));
+        for (size_t i = 0; i < x.size(); i++)
+        {
+            const _Float16 h = _Float16(x[i] / column.scale);
+            memcpy(&column.bits[i], &h, sizeof(h));
+        }
+    }
+    else if (encoding == ENC_BF16)
+    {
+        for (size_t i = 0; i < x.size(); i++)
+        {
+            uint32_t u;
+            memcpy(&u, &x[i], sizeof(u));
+            column.bits[i] = uint16_t((u + 0x7FFF + ((u >> 16) & 1)) >> 16);
+        }
+    }
+    else if (encoding == ENC_INT16)
+    {
+        // relative columns are centred on 0 and a nonzero x never rounds to 0, so that the sign of x is kept
+        column.base = column.relative ? 0.0f : 0.5f * (lo + hi);
+        const float half_range = column.relative ? std::max(std::fabs(lo), std::fabs(hi)) : 0.5f * (hi - lo);
+        column.scale = half_range > 0.0f ? half_range / 32766.0f : 1.0f;
+        for (size_t i = 0; i < x.size(); i++)
+        {
+            long q = std::lround((x[i] - column.base) / column.scale);
+            if (column.relative && q == 0 && x[i] != 0.0f)
+                q = x[i] > 0.0f ? 1 : -1;
+            column.bits[i] = uint16_t(values[i] == 0.0f ? INT16_ZERO : int16_t(q));
+        }
+    }
+    else
+    {
+        std::cout << "encode_column: unsupported encoding " << int(encoding) << std::endl;
+        std::abort();
+    }
+    return column;
+}
+
+// without F16C the _Float16 conversions are library calls, so decoding goes through a table of the 65536 halves
+static const std::vector<float> &half_to_float_table()
+{
+    static const std::vector<float> table = []()
+    {
+        std::vector<float> t(65536);
+        for (uint32_t bits = 0; bits < 65536; bits++)
+        {
+            const uint16_t b = uint16_t(bits);
+            _Float16 h;
+            memcpy(&h, &b, sizeof(h));
+            t[bits] = float(h);
+        }
+        return t;
+    }();
+    return table;
+}
+
+void decode_column(const COMPACT_COLUMN &column, float *out, const float *reference)
+{
+    const size_t nb = column.bits.size();
+    const float *half_to_float = half_to_float_table().data();
+    for (size_t i = 0; i < nb; i++)
+    {
+        float x;
+        bool zero = false;
+        if (column.encoding == ENC_FP16)
+        {
+            x = half_to_float[column.bits[i]] * column.scale;
+        }
+        else if (column.encoding == ENC_BF16)
+        {
+            const uint32_t u = uint32_t(column.bits[i]) << 16;
+            memcpy(&x, &u, sizeof(u));
+        }
+        else
+        {
+            const int16_t q = int16_t(column.bits[i]);
+            zero = q == INT16_ZERO;
+            x = column.base + float(q) * column.scale;
+        }
+        out[i] = zero ? 0.0f : column.relative ? reference[i] * (1.0f + x) : x;
+    }
+}
+
+const float *compact_reference(const KLINEf &kline, const INDICATOR_SPEC &spec)
+{
+    return spec.kind == IND_EMA || spec.kind == IND_SMA ? kline.close.data() : nullptr;
+}
+
+static int sign_of(const float x)
+{
+    return (x > 0.0f) - (x < 0.0f);
+}
+
+bool compact_column_agrees(const KLINEf &kline, const COLUMN_DECISIONS &decisions, const std::vector<float> &exact,
+                           const std::vector<float> &decoded, const float *input)
+{
+    if (decisions.input && input == nullptr)
+        return false;
+    for (size_t i = 0; i < exact.size(); i++)
+    {
+        if (decisions.close && sign_of(kline.close[i] - exact[i]) != sign_of(kline.close[i] - decoded[i]))
+            return false;
+        if (decisions.input && sign_of(input[i] - exact[i]) != sign_of(input[i] - decoded[i]))
+            return false;
+        for (const float level : decisions.levels)
+        {
+            if (sign_of(exact[i] - level) != sign_of(decoded[i] - level))
+                return false;
+        }
+    }
+    return true;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+// Stored indicator "<fingerprint>-<packed spec>.ind": header, then float values[nb]
+static const char INDICATOR_FILE_MAGIC[8] = {'I', 'N', 'D', 'I', 'C', 'B', 'I', 'N'};
+static const uint32_t INDICATOR_FILE_VERSION = 2; // 2: SuperTrend multipliers in tenths
+
+struct INDICATOR_FILE_HEADER
+{
+    char magic[8];
+    uint32_t version;
+    uint32_t padding_1;
+    uint64_t fingerprint;
+    uint64_t packed_spec;
+    uint64_t nb;
+    uint8_t padding_2[24]; // keeps the values 64 bytes aligned
+};
+static_assert(sizeof(INDICATOR_FILE_HEADER) == 64, "unexpected INDICATOR_FILE_HEADER size");
+
+// FNV-1a on 32-bit words, over the sizes and contents of every column
+uint64_t kline_fingerprint(const KLINEf &kline)
+{
+    uint64_t hash = 0xcbf29ce484222325ull;
+    const auto mix = [&hash](const uint32_t word)
+    { hash = (hash ^ word) * 0x100000001b3ull; };
+    const auto mix_column = [&mix](const auto &column)
+    {
+        mix(uint32_t(column.size()));
+        for (const auto &value : column)
+        {
+            uint32_t word;
+            memcpy(&word, &value, sizeof(word));
+            mix(word);
+        }
+    };
+    mix_column(kline.timestamp);
+    mix_column(kline.open);
+    mix_column(kline.high);
+    mix_column(kline.low);
+    mix_column(kline.close);
+    mix_column(kline.volume);
+    return hash;
+}
+
+INDICATOR_REGISTRY::~INDICATOR_REGISTRY()
+{
+    for (uint handle = 0; handle < CAPACITY; handle++)
+    {
+        if (slots[handle].map != nullptr)
+            munmap(slots[handle].map, slots[handle].map_size);
+    }
+}
+
+// deletes the least recently used files of the store (loading a file touches it) until it holds at most max_bytes.
+// Files of data that changed since are never loaded again, so they go first; leftovers of interrupted writes count too
+static void trim_indicator_store(const std::string &dir, const size_t max_bytes)
+{
+    DIR *stream = opendir(dir.c_str());
+    if (stream == nullptr)
+        return;
+    struct STORED_FILE
+    {
+        int64_t used_ns;
+        size_t size;
+        std::string path;
+    };
+    std::vector<STORED_FILE> files;
+    size_t total = 0;
+    while (const dirent *entry = readdir(stream))
+    {
+        const std::string path = dir + "/" + entry->d_name;
+        struct stat st;
+        if (strstr(entry->d_name, ".ind") == nullptr || stat(path.c_str(), &st) != 0 || !S_ISREG(st.st_mode))
+            continue;
+        files.push_back({int64_t(st.st_mtim.tv_sec) * 1000000000 + st.st_mtim.tv_nsec, size_t(st.st_size), path});
+        total += st.st_size;
+    }
+    closedir(stream);
+
+    std::sort(files.begin(), files.end(), [](const STORED_FILE &a, const STORED_FILE &b)
+              { return a.used_ns < b.used_ns; });
+    for (size_t j = 0; j < files.size() && total > max_bytes; j++)
+    {
+        if (unlink(files[j].path.c_str()) == 0)
+            total -= files[j].size;
+    }
+}
+
+void INDICATOR_REGISTRY::store_in(const std::string &dir, const KLINEf &kline)
+{
+    if (mkdir(dir.c_str(), 0755) != 0 && errno != EEXIST)
+    {
+        std::cout << "WARNING: cannot create indicator store " << dir << ", indicators will not be stored" << std::endl;
+        return;
+    }
+    // once per run, before the registries of the pairs write to it
+    static std::once_flag trimmed;
+    std::call_once(trimmed, trim_indicator_store, dir, INDICATOR_STORE_BYTES);
+    store_dir = dir;
+    fingerprint = kline_fingerprint(kline);
+}
+
+std::string INDICATOR_REGISTRY::stored_path(const uint64_t packed_spec) const
+{
+    char name[48];
+    snprintf(name, sizeof(name), "/%016llx-%016llx.ind", (unsigned long long)fingerprint, (unsigned long long)packed_spec);
+    return store_dir + name;
+}
+
+// called with slot.lock held, after any change of what the slot holds
+void INDICATOR_REGISTRY::account(SLOT &slot)
+{
+    const size_t bytes = (slot.map != nullptr ? slot.map_size - sizeof(INDICATOR_FILE_HEADER) : 0) +
+                         slot.values.capacity() * sizeof(float) + slot.compact.bits.capacity() * sizeof(uint16_t);
+    used_bytes += bytes;
+    used_bytes -= slot.bytes.exchange(bytes);
+    slot.compact_resident.store(!slot.compact.bits.empty());
+}
+
+bool INDICATOR_REGISTRY::load_stored(SLOT &slot, const uint64_t packed_spec, const uint nb)
+{
+    const std::string path = stored_path(packed_spec);
+    const int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+        return false;
+
+    const size_t size = sizeof(INDICATOR_FILE_HEADER) + size_t(nb) * sizeof(float);
+    struct stat st;
+    if (fstat(fd, &st) != 0 || size_t(st.st_size) != size)
+    {
+        close(fd);
+        return false;
+    }
+
+    void *map = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED)
+        return false;
+
+    const INDICATOR_FILE_HEADER *header = static_cast<const INDICATOR_FILE_HEADER *>(map);
+    const bool valid = memcmp(header->magic, INDICATOR_FILE_MAGIC, sizeof(INDICATOR_FILE_MAGIC)) == 0 &&
+                       header->version == INDICATOR_FILE_VERSION &&
+                       header->fingerprint == fingerprint &&
+                       header->packed_spec == packed_spec &&
+                       header->nb == nb;
+    if (!valid)
+    {
+        munmap(map, size);
+        return false;
+    }
+
+    utimensat(AT_FDCWD, path.c_str(), nullptr, 0); // last use, for trim_indicator_store()
+    slot.map = map;
+    slot.map_size = size;
+    return true;
+}
+
+void INDICATOR_REGISTRY::write_stored(const SLOT &slot, const uint64_t packed_spec) const
+{
+    INDICATOR_FILE_HEADER header{};
+    memcpy(header.magic, INDICATOR_FILE_MAGIC, sizeof(INDICATOR_FILE_MAGIC));
+    header.version = INDICATOR_FILE_VERSION;
+    header.fingerprint = fingerprint;
+    header.packed_spec = packed_spec;
+    header.nb = slot.values.size();
+
+    // write to a temporary file and rename it, so that concurrent runs never map a half-written indicator
+    const std::string path = stored_path(packed_spec);
+    const std::string tmp_path = path + ".tmp" + std::to_string(getpid()) + "-" + std::to_string(uintptr_t(&slot));
+    std::ofstream out(tmp_path, std::ios::binary | std::ios::trunc);
+    if (!out.is_open())
+    {
+        std::cout << "WARNING: cannot write indicator " << path << std::endl;
+        return;
+    }
+    out.write(reinterpret_cast<const char *>(&header), sizeof(header));
+    out.write(reinterpret_cast<const char *>(slot.values.data()), std::streamsize(slot.values.size() * sizeof(float)));
+    out.close();
+
+    if (!out || rename(tmp_path.c_str(), path.c_str()) != 0)
+    {
+        std::cout << "WARNING: cannot write indicator " << path << std::endl;
+        unlink(tmp_path.c_str());
+    }
+}
+
+uint INDICATOR_REGISTRY::find_slot(const uint64_t key)
+{
+    // linear probing from a multiplicative hash of the key
+    uint handle = uint((key * 0x9E3779B97F4A7C15ull) >> 40) & (CAPACITY - 1);
+    for (uint probe = 0; probe < CAPACITY; probe++, handle = (handle + 1) & (CAPACITY - 1))
+    {
+        SLOT &slot = slots[handle];
+        uint64_t found = slot.key.load(std::memory_order_acquire);
+        if (found == 0 && slot.key.compare_exchange_strong(found, key, std::memory_order_acq_rel))
+            found = key;
+        if (found == key)
+            return handle;
+    }
+
+    std::cout << "Indicator registry full (" << CAPACITY << " indicators for one pair)." << std::endl;
+    std::abort();
+}
+
+// called with slot.lock held. Brings the column back without computing it: decoded from its compact copy when only its
+// floats were dropped, or mapped from the store. False when it has to be computed
+bool INDICATOR_REGISTRY::restore(SLOT &slot, const KLINEf &kline, const INDICATOR_SPEC &spec)
+{
+    if (!slot.compact.bits.empty())
+    {
+        slot.values.resize(slot.compact.bits.size());
+        decode_column(slot.compact, slot.values.data(), compact_reference(kline, spec));
+        account(slot);
+        slot.data.store(slot.values.data());
+        return true;
+    }
+
+    const auto t0 = std::chrono::steady_clock::now();
+    if (store_dir.empty() || !load_stored(slot, pack_indicator_spec(spec), kline.nb))
+        return false;
+    nb_loaded++;
+    // a loaded indicator is cheap to bring back, so it is evicted before the computed ones
+    publish(slot, kline, spec, reinterpret_cast<const float *>(static_cast<const char *>(slot.map) + sizeof(INDICATOR_FILE_HEADER)), t0);
+    return true;
+}
+
+// called with slot.lock held. Inputs are acquired with their own slot lock, always from a derived indicator to its
+// input, so two computations never wait on each other
+void INDICATOR_REGISTRY::compute(SLOT &slot, const KLINEf &kline, const INDICATOR_SPEC &spec)
+{
+    if (restore(slot, kline, spec))
+        return;
+
+    const auto t0 = std::chrono::steady_clock::now();
+    // derived from the registry's copy of its input, which the other indicators on that input share
+    INDICATOR_SPEC input_spec;
+    if (indicator_input(spec, input_spec))
+    {
+        const uint input = acquire(kline, input_spec);
+        slot.values.resize(kline.nb);
+        compute_indicator(kline, spec, span(input), slot.values.data());
+        release(input);
+    }
+    else
+    {
+        slot.values.resize(kline.nb);
+        compute_indicator(kline, spec, nullptr, slot.values.data());
+    }
+    publish_computed(slot, kline, spec, t0);
+}
+
+// called with slot.lock held, once slot.values holds the computed column
+void INDICATOR_REGISTRY::publish_computed(SLOT &slot, const KLINEf &kline, const INDICATOR_SPEC &spec, const std::chrono::steady_clock::time_point t0)
+{
+    nb_computed++;
+    // the inputs are recomputed with the indicators derived from them, which are stored
+    if (!store_dir.empty() && !is_indicator_input(spec.kind))
+        write_stored(slot, pack_indicator_spec(spec));
+    publish(slot, kline, spec, slot.values.data(), t0);
+}
+
+// called with slot.lock held: compacts data when the encoding allows it, then makes the column visible to span().
+// Its cost is the time since t0
+void INDICATOR_REGISTRY::publish(SLOT &slot, const KLINEf &kline, const INDICATOR_SPEC &spec, const float *data, const std::chrono::steady_clock::time_point t0)
+{
+    if (encoding != ENC_FLOAT32 && spec.kind != IND_ATR && !is_indicator_input(spec.kind) && decisions.count(spec.kind) != 0)
+        data = compact(slot, kline, spec, data);
+    const auto t1 = std::chrono::steady_clock::now();
+
+    slot.cost_ns.store(std::chrono::duration_cast<std::chrono::nanoseconds>(t1 - t0).count());
+    slot.priority.store(inflation.load() + slot.cost_ns.load());
+    account(slot);
+    slot.data.store(data);
+}
+
+// called with slot.lock held. The bar loops then always see the decoded values, whether the column was just computed,
+// loaded from the store or decoded again after its floats were dropped
+const float *INDICATOR_REGISTRY::compact(SLOT &slot, const KLINEf &kline, const INDICATOR_SPEC &spec, const float *exact)
+{
+    const std::vector<float> exact_values(exact, exact + kline.nb);
+    COMPACT_COLUMN column = encode_column(exact_values, encoding, compact_reference(kline, spec));
+    std::vector<float> decoded(kline.nb);
+    decode_column(column, decoded.data(), compact_reference(kline, spec));
+
+    // the input is acquired from the derived indicator, as in compute()
+    const COLUMN_DECISIONS &uses = decisions.at(spec.kind);
+    INDICATOR_SPEC input_spec;
+    const bool has_input = uses.input && indicator_input(spec, input_spec);
+    const uint input = has_input ? acquire(kline, input_spec) : 0;
+    const bool agrees = compact_column_agrees(kline, uses, exact_values, decoded, has_input ? span(input) : nullptr);
+    if (has_input)
+        release(input);
+    if (!agrees)
+    {
+        nb_kept_exact++;
+        return exact;
+    }
+
+    if (slot.map != nullptr)
+    {
+        munmap(slot.map, slot.map_size);
+        slot.map = nullptr;
+        slot.map_size = 0;
+    }
+    slot.compact = std::move(column);
+    slot.values.swap(decoded);
+    return slot.values.data();
+}
+
+uint INDICATOR_REGISTRY::resolve(const KLINEf &kline, const INDICATOR_SPEC &spec)
+{
+    const uint handle = find_slot(pack_indicator_spec(spec) + 1);
+    SLOT &slot = slots[handle];
+
+    if (slot.data.load(std::memory_order_acquire) == nullptr)
+    {
+        const std::lock_guard<std::mutex> guard(slot.lock);
+        if (slot.data.load() == nullptr)
+            compute(slot, kline, spec);
+    }
+    return handle;
+}
+
+const float *INDICATOR_REGISTRY::span(const KLINEf &kline, const INDICATOR_SPEC &spec)
+{
+    if (budget_bytes != 0)
+    {
+        std::cout << "ERROR: span(kline, spec) does not pin its indicator, use acquire() / release() under a budget" << std::endl;
+        std::abort();
+    }
+    return span(resolve(kline, spec));
+}
+
+std::vector<uint> INDICATOR_REGISTRY::resolve(const KLINEf &kline, const std::vector<INDICATOR_SPEC> &specs)
+{
+    // the specs that are not resident are resolved batch by batch (see same_indicator_batch), the others one by one
+    std::vector<uint> handles;
+    std::vector<uint> pending;
+    std::vector<INDICATOR_SPEC> pending_specs;
+    for (const INDICATOR_SPEC &spec : specs)
+    {
+        const uint handle = find_slot(pack_indicator_spec(spec) + 1);
+        handles.push_back(handle);
+        if (!same_indicator_batch(spec, spec))
+        {
+            resolve(kline, spec);
+            continue;
+        }
+        if (slots[handle].data.load(std::memory_order_acquire) == nullptr &&
+            std::find(pending.begin(), pending.end(), handle) == pending.end())
+        {
+            pending.push_back(handle);
+            pending_specs.push_back(spec);
+        }
+    }
+
+    std::vector<bool> done(pending.size(), false);
+    for (size_t first = 0; first < pending.size(); first++)
+    {
+        if (done[first])
+            continue;
+        std::vector<uint> batch;
+        std::vector<INDICATOR_SPEC> batch_specs;
+        for (size_t j = first; j < pending.size(); j++)
+        {
+            if (!done[j] && same_indicator_batch(pending_specs[first], pending_specs[j]))
+            {
+                done[j] = true;
+                batch.push_back(pending[j]);
+                batch_specs.push_back(pending_specs[j]);
+            }
+        }
+        compute_batch(kline, batch, batch_specs);
+    }
+    if (!pending.empty() && budget_bytes > 0 && used_bytes.load() > budget_bytes)
+        evict_over_budget();
+    return handles;
+}
+
+// holds the locks of all the batch slots, taken in handle order so that two batches sharing slots cannot wait on each
+// other, while the columns are restored or computed: the threads resolving or acquiring one of them meanwhile wait for
+// it, as for a single compute(). The input is acquired under these locks, from the derived indicators as in compute()
+void INDICATOR_REGISTRY::compute_batch(const KLINEf &kline, const std::vector<uint> &batch, const std::vector<INDICATOR_SPEC> &specs)
+{
+    std::vector<uint> sorted(batch);
+    std::sort(sorted.begin(), sorted.end());
+    std::vector<std::unique_lock<std::mutex>> guards;
+    for (const uint handle : sorted)
+    {
+        guards.emplace_back(slots[handle].lock);
+    }
+
+    // what is still missing once the locks are held, and not in the store
+    std::vector<uint> missing;
+    std::vector<INDICATOR_SPEC> missing_specs;
+    for (size_t j = 0; j < batch.size(); j++)
+    {
+        SLOT &slot = slots[batch[j]];
+        if (slot.data.load() == nullptr && !restore(slot, kline, specs[j]))
+        {
+            missing.push_back(batch[j]);
+            missing_specs.push_back(specs[j]);
+        }
+    }
+    if (missing.empty())
+        return;
+
+    const auto t0 = std::chrono::steady_clock::now();
+    std::vector<std::vector<float>> columns(missing.size(), std::vector<float>(kline.nb));
+    std::vector<float *> out;
+    for (std::vector<float> &column : columns)
+    {
+        out.push_back(column.data());
+    }
+    INDICATOR_SPEC input_spec;
+    if (indicator_input(missing_specs[0], input_spec))
+    {
+        const uint input = acquire(kline, input_spec);
+        compute_indicators(kline, missing_specs, span(input), out.data());
+        release(input);
+    }
+    else
+        compute_indicators(kline, missing_specs, nullptr, out.data());
+    // each column costs its share of the batch
+    const auto t1 = std::chrono::steady_clock::now();
+    const auto t_column = t1 - (t1 - t0) / missing.size();
+
+    for (size_t j = 0; j < missing.size(); j++)
+    {
+        SLOT &slot = slots[missing[j]];
+        slot.values.swap(columns[j]);
+        publish_computed(slot, kline, missing_specs[j], t_column);
+    }
+}
+
+uint INDICATOR_REGISTRY::acquire(const KLINEf &kline, const INDICATOR_SPEC &spec)
+{
+    const uint handle = find_slot(pack_indicator_spec(spec) + 1);
+    SLOT &slot = slots[handle];
+
+    // pin before looking at data: try_evict() clears data before looking at pins, so (all sequentially consistent)
+    // either it sees the pin or this thread sees nullptr and recomputes under the slot lock
+    slot.pins++;
+    if (slot.data.load() == nullptr)
+    {
+        bool computed = false;
+        {
+            const std::lock_guard<std::mutex> guard(slot.lock);
+            if (slot.data.load() == nullptr)
+            {
+                compute(slot, kline, spec);
+                computed = true;
+            }
+        }
+        if (computed && budget_bytes > 0 && used_bytes.load() > budget_bytes)
+            evict_over_budget();
+    }
+    slot.priority.store(inflation.load() + slot.cost_ns.load());
+    return handle;
+}
+
+// frees the unpinned indicators of lowest priority until the registry fits its budget, or nothing can be freed.
+// The decoded floats of compact columns go first, then whole indicators
+void INDICATOR_REGISTRY::evict_over_budget()
+{
+    const std::lock_guard<std::mutex> guard(evict_lock);
+    for (const bool demote : {true, false})
+    {
+        // the slots try_evict() could not free (busy, or acquired meanwhile) are not picked again in this pass
+        std::vector<bool> skipped(CAPACITY, false);
+        while (used_bytes.load() > budget_bytes)
+        {
+            uint victim = CAPACITY;
+            uint64_t lowest = UINT64_MAX;
+            for (uint handle = 0; handle < CAPACITY; handle++)
+            {
+                const SLOT &slot = slots[handle];
+                if (skipped[handle] || slot.bytes.load() == 0 || slot.pins.load() != 0 ||
+                    (demote && (!slot.compact_resident.load() || slot.data.load() == nullptr)))
+                    continue;
+                const uint64_t priority = slot.priority.load();
+                if (priority < lowest)
+                {
+                    lowest = priority;
+                    victim = handle;
+                }
+            }
+            if (victim == CAPACITY)
+                break;
+            if (try_evict(slots[victim], demote))
+                inflation.store(std::max(inflation.load(), lowest));
+            else
+                skipped[victim] = true;
+        }
+    }
+}
+
+// demote: only drop the floats of a compact column (the slot must still hold floats)
+bool INDICATOR_REGISTRY::try_evict(SLOT &slot, const bool demote)
+{
+    // a slot being computed is not a candidate anyway
+    if (!slot.lock.try_lock())
+        return false;
+
+    const float *data = slot.data.load();
+    bool freed = false;
+    if (slot.bytes.load() != 0 && (data != nullptr || !demote))
+    {
+        slot.data.store(nullptr);
+        if (slot.pins.load() != 0)
+        {
+            // acquired meanwhile: the acquiring thread either saw data, or waits on slot.lock and will see it again
+            slot.data.store(data);
+        }
+        else
+        {
+            if (slot.map != nullptr)
+            {
+                munmap(slot.map, slot.map_size);
+                slot.map = nullptr;
+                slot.map_size = 0;
+            }
+            std::vector<float>().swap(slot.values);
+            if (!demote)
+            {
+                slot.compact = COMPACT_COLUMN{};
+                nb_evicted++;
+            }
+            account(slot);
+            freed = true;
+        }
+    }
+    slot.lock.unlock();
+    return freed;
 }
@@ -1,3 +1,4 @@
+#pragma once
 #include <iostream>
 #include <vector>
 #include <string>
@@ -6,6 +7,12 @@
 #include <ta-lib/ta_libc.h>
 #include <unordered_map>
 #include <map>
+#include <cstdint>
+#include <atomic>
+#include <mutex>
+#include <memory>
+#include <chrono>
+#include <algorithm>
 
 //////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 struct KLINEf
@@ -15,6 +22,7 @@ struct KLINEf
     std::vector<float> high;
     std::vector<float> low;
     std::vector<float> close;
+    std::vector<float> volume; // only loaded on demand (KLINE_VOLUME)
     std::unordered_map<std::string, std::vector<float>> indicators;
     uint nb;
 };
@@ -31,39 +39,432 @@ std::vector<float> float_range(const float min, const float max, const float ste
 
 //////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
+// Every wrapper has an overload writing into a caller-provided span out[nb] (zeros over the warm-up bars, in place
+// on the input allowed); the vector versions allocate the result and call it. TA-lib's double output goes through a
+// per-thread buffer, nothing proportional to nb is put on the stack
+
 std::vector<float> TALIB_MIN(const std::vector<float> &vals, const int period);
 std::vector<float> TALIB_MAX(const std::vector<float> &vals, const int period);
+void TALIB_MIN(const float *vals, const uint nb, const int period, float *out);
+void TALIB_MAX(const float *vals, const uint nb, const int period, float *out);
+// TALIB_MIN / TALIB_MAX of several windows, out[j] receiving the nb values of windows[j]. One window goes to TA-lib,
+// several take a van Herk / Gil-Werman pass each (3 comparisons per bar, whatever the window)
+void ROLLING_MIN(const float *vals, const uint nb, const std::vector<int> &windows, float *const *out);
+void ROLLING_MAX(const float *vals, const uint nb, const std::vector<int> &windows, float *const *out);
 
 //////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
 std::vector<float> TALIB_RSI(const std::vector<float> &vals, const int period);
+void TALIB_RSI(const float *vals, const uint nb, const int period, float *out);
 
 //////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
 std::vector<float> TALIB_EMA(const std::vector<float> &vals, const int period);
+void TALIB_EMA(const float *vals, const uint nb, const int period, float *out);
+// TALIB_EMA of several periods in one pass over vals, with the same values bit for bit: out[j] receives the
+// vals.size() values of periods[j]
+void EMA_BATCH(const std::vector<float> &vals, const std::vector<int> &periods, float *const *out);
 std::vector<float> TALIB_SMA(const std::vector<float> &vals, const int period);
+void TALIB_SMA(const float *vals, const uint nb, const int period, float *out);
 std::vector<float> TALIB_ATR(const std::vector<float> &high, const std::vector<float> &low, const std::vector<float> &close, const int period);
+void TALIB_ATR(const float *high, const float *low, const float *close, const uint nb, const int period, float *out);
 std::vector<float> TALIB_TRIX(const std::vector<float> &vals, const int trixLength, const int trixSignal);
+// the stages of TALIB_TRIX, so that the triple EMA and its percent change of a length can be shared by every signal
+// length: triple EMA -> percent change -> histogram (percent change minus its SMA over trixSignal). The first two may
+// work in place
+void TALIB_TRIPLE_EMA(const float *vals, const uint nb, const int trixLength, float *out);
+void TALIB_TRIX_PCT(const float *triple_ema, const uint nb, float *out);
+void TALIB_TRIX_from_pct(const float *trix_pct, const uint nb, const int trixSignal, float *out);
+void TALIB_TRIX_from_triple_ema(const float *triple_ema, const uint nb, const int trixSignal, float *out);
 
 //////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
 std::vector<float> TALIB_STOCHRSI_K(const std::vector<float> &vals, const int nb_period_stoch, const int nb_period_rsi, const int k_period, const int d_period);
 std::vector<float> TALIB_STOCHRSI_D(const std::vector<float> &vals, const int nb_period_stoch, const int nb_period_rsi, const int k_period, const int d_period);
 std::vector<float> TALIB_STOCHRSI_not_averaged(const std::vector<float> &vals, const int nb_period_stoch, const int nb_period_rsi);
+void TALIB_STOCHRSI_from_rsi(const float *rsi, const uint nb, const int nb_period_stoch, float *out);
+// TALIB_STOCHRSI_from_rsi of several stoch windows on one RSI, out[j] for windows[j]
+void STOCHRSI_BATCH(const float *rsi, const uint nb, const std::vector<int> &windows, float *const *out);
 
 //////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
+// TALIB_ATR of several windows, sharing one true range pass. out[j] receives the nb values of windows[j]
+void ATR_BATCH(const float *high, const float *low, const float *close, const uint nb, const std::vector<int> &windows, float *const *out);
+// single pass SuperTrend on a precomputed ATR: dir gets +1 / -1, the final bands are written only when lowerband and
+// upperband are not nullptr
+void SUPERTREND_DIRECTION(const float *high, const float *low, const float *close, const float *atr, const uint nb,
+                          const float multiplier, float *dir, float *lowerband, float *upperband);
+// directions of the whole (atr_windows x multipliers) grid: out[iw * multipliers.size() + im]. The true range is
+// computed once, and each ATR once for all the multipliers
+void SUPERTREND_BATCH(const float *high, const float *low, const float *close, const uint nb,
+                      const std::vector<int> &atr_windows, const std::vector<float> &multipliers, float *const *out);
 SuperTrend TALIB_SuperTrend(const std::vector<float> &high, const std::vector<float> &low, const std::vector<float> &close,
-                            const int atr_window, const int atr_multi);
+                            const int atr_window, const float atr_multi);
 std::vector<float> TALIB_SuperTrend_dir_only(const std::vector<float> &high, const std::vector<float> &low, const std::vector<float> &close,
-                                             const int atr_window, const int atr_multi);
+                                             const int atr_window, const float atr_multi);
 //////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 std::vector<float> TALIB_AO(const std::vector<float> &high, const std::vector<float> &low,
                             const int fast, const int slow);
+void TALIB_MEDIAN_PRICE(const float *high, const float *low, const uint nb, float *out);
+void TALIB_AO_from_median_price(const float *median_price, const uint nb, const int fast, const int slow, float *out);
+
+// SMA of any period at any bar in O(1), from the prefix sums of the series (in double). The sums round differently
+// from TA_SMA's running window sum, so the floats can differ from TALIB_SMA in the last bit (rarely: never on the
+// Binance 1h median prices)
+struct PREFIX_SUM_SMA
+{
+    std::vector<double> sums; // sums[i] = vals[0] + ... + vals[i - 1]
+
+    PREFIX_SUM_SMA() = default;
+    PREFIX_SUM_SMA(const float *vals, const uint nb);
+
+    // TALIB_SMA(vals, period)[i], 0 until the window is full
+    float sma(const uint i, const int period) const
+    {
+        if (i + 1 < uint(period))
+            return 0.0f;
+        return (sums[i + 1] - sums[i + 1 - period]) / period;
+    }
+
+    // TALIB_AO_from_median_price(vals, nb, fast, slow, out) when vals is the median price, in one pass of subtractions
+    void ao(const int fast, const int slow, float *out) const;
+};
 
 //////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 std::vector<float> TALIB_WILLR(const std::vector<float> &high, const std::vector<float> &low, const std::vector<float> &close,
                                const int length);
+void TALIB_WILLR(const float *high, const float *low, const float *close, const uint nb, const int length, float *out);
+// TALIB_WILLR of several lengths from ROLLING_MAX / ROLLING_MIN, with the same values (TALIB_WILLR for one length)
+void WILLR_BATCH(const float *high, const float *low, const float *close, const uint nb, const std::vector<int> &lengths, float *const *out);
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+// Streaming indicators: update() takes the next bar in O(1) (amortised for the rolling extrema) and returns the value the
+// batch wrapper gives at that bar, zeros of the warm-up included. A chained stage is fed every output of the previous
+// one, warm-up zeros included, as the batch wrappers do with the full series
+
+struct STREAM_SMA // TALIB_SMA, period >= 2
+{
+    int period;
+    std::vector<float> window; // last period inputs, input i at i % period
+    double total = 0.0;
+    uint nb = 0;
+
+    STREAM_SMA(const int period) : period(period), window(period) {}
+    float update(const float val);
+};
+
+struct STREAM_EMA // TALIB_EMA
+{
+    int period;
+    double k;
+    double ema = 0.0; // sum of the inputs until the seed
+    uint nb = 0;
+
+    STREAM_EMA(const int period) : period(period), k(2.0 / (period + 1)) {}
+    float update(const float val);
+};
+
+struct STREAM_RSI // TALIB_RSI, period >= 2
+{
+    int period;
+    double prev_value = 0.0;
+    double gain = 0.0;
+    double loss = 0.0;
+    uint nb = 0;
+
+    STREAM_RSI(const int period) : period(period) {}
+    float update(const float val);
+};
+
+struct STREAM_ATR // TALIB_ATR
+{
+    int period;
+    double prev_close = 0.0;
+    double atr = 0.0; // sum of the true ranges until the seed
+    uint nb = 0;
+
+    STREAM_ATR(const int period) : period(period) {}
+    float update(const float high, const float low, const float close);
+};
+
+struct STREAM_EXTREMUM // TALIB_MAX / TALIB_MIN (ROLLING_MAX / ROLLING_MIN)
+{
+    int period;
+    bool maximum;
+    // monotonic deque of the candidates (bar, value), in a ring of period slots from head
+    std::vector<uint> bars;
+    std::vector<float> values;
+    uint head = 0;
+    uint size = 0;
+    uint nb = 0;
+
+    STREAM_EXTREMUM(const int period, const bool maximum) : period(period), maximum(maximum), bars(period), values(period) {}
+    float update(const float val);
+};
+
+struct STREAM_STOCHRSI // TALIB_STOCHRSI_not_averaged
+{
+    STREAM_RSI rsi;
+    STREAM_EXTREMUM highest;
+    STREAM_EXTREMUM lowest;
+
+    STREAM_STOCHRSI(const int period_stoch, const int period_rsi)
+        : rsi(period_rsi), highest(period_stoch, true), lowest(period_stoch, false) {}
+    float update(const float val);
+};
+
+struct STREAM_STOCHRSI_KD // TALIB_STOCHRSI_K and TALIB_STOCHRSI_D
+{
+    STREAM_STOCHRSI stochrsi;
+    STREAM_SMA k_sma;
+    STREAM_SMA d_sma;
+    float k = 0.0f;
+    float d = 0.0f;
+
+    STREAM_STOCHRSI_KD(const int period_stoch, const int period_rsi, const int period_k, const int period_d)
+        : stochrsi(period_stoch, period_rsi), k_sma(period_k), d_sma(period_d) {}
+    // returns d, k is kept in k
+    float update(const float val)
+    {
+        k = k_sma.update(stochrsi.update(val));
+        d = d_sma.update(k);
+        return d;
+    }
+};
+
+struct STREAM_TRIX // TALIB_TRIX histogram
+{
+    STREAM_EMA ema1;
+    STREAM_EMA ema2;
+    STREAM_EMA ema3;
+    STREAM_SMA signal;
+    float prev_triple = 0.0f;
+    uint nb = 0;
+
+    STREAM_TRIX(const int trixLength, const int trixSignal)
+        : ema1(trixLength), ema2(trixLength), ema3(trixLength), signal(trixSignal) {}
+    float update(const float val);
+};
+
+struct STREAM_SUPERTREND // SUPERTREND_DIRECTION of TALIB_ATR(atr_window), the bands are kept too
+{
+    STREAM_ATR atr;
+    float multiplier;
+    float direction = 1.0f;
+    float lowerband = 0.0f;
+    float upperband = 0.0f;
+    uint nb = 0;
+
+    STREAM_SUPERTREND(const int atr_window, const float multiplier) : atr(atr_window), multiplier(multiplier) {}
+    float update(const float high, const float low, const float close);
+};
+
+struct STREAM_AO // TALIB_AO
+{
+    STREAM_SMA fast_sma;
+    STREAM_SMA slow_sma;
+
+    STREAM_AO(const int fast, const int slow) : fast_sma(std::min(fast, slow)), slow_sma(std::max(fast, slow)) {}
+    float update(const float high, const float low)
+    {
+        const float median_price = 0.5f * (high + low);
+        const float fast = fast_sma.update(median_price);
+        return fast - slow_sma.update(median_price);
+    }
+};
+
+struct STREAM_WILLR // TALIB_WILLR
+{
+    STREAM_EXTREMUM highest;
+    STREAM_EXTREMUM lowest;
+    uint nb = 0;
+
+    STREAM_WILLR(const int length) : highest(length, true), lowest(length, false) {}
+    float update(const float high, const float low, const float close);
+};
 
 //////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 void RESAMPLE_TIMEFRAME(KLINEf &kline_in_in, KLINEf &kline_out, const int tf_in, const int tf_out);
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+// indicators a strategy can request from an INDICATOR_REGISTRY, with the parameters of the matching TALIB_ wrapper
+enum INDICATOR_KIND : uint8_t
+{
+    IND_EMA,           // p1 = period
+    IND_SMA,           // p1 = period
+    IND_RSI,           // p1 = period
+    IND_ATR,           // p1 = period
+    IND_WILLR,         // p1 = length
+    IND_STOCHRSI,      // p1 = stoch period, p2 = rsi period (not averaged)
+    IND_STOCHRSI_K,    // p1 = stoch period, p2 = rsi period, p3 = k period, p4 = d period
+    IND_STOCHRSI_D,    // same as IND_STOCHRSI_K
+    IND_TRIX,          // p1 = trix length, p2 = signal length
+    IND_AO,            // p1 = fast, p2 = slow
+    IND_SUPERTREND_DIR, // p1 = atr window, p2 = atr multiplier in tenths (see supertrend_dir_spec)
+    IND_TRIPLE_EMA,     // p1 = length, EMA of EMA of EMA of the close (input of IND_TRIX)
+    IND_MEDIAN_PRICE,   // (high + low) / 2 (input of IND_AO)
+    IND_TRIX_PCT        // p1 = trix length, percent change of IND_TRIPLE_EMA (input of IND_TRIX)
+};
+
+struct INDICATOR_SPEC
+{
+    INDICATOR_KIND kind;
+    int p1 = 0;
+    int p2 = 0;
+    int p3 = 0;
+    int p4 = 0;
+};
+
+// IND_SUPERTREND_DIR spec of a fractional multiplier (1.5 -> p2 = 15), aborts unless it is a multiple of 0.1
+INDICATOR_SPEC supertrend_dir_spec(const int atr_window, const float multiplier);
+inline float supertrend_multiplier(const INDICATOR_SPEC &spec) { return spec.p2 / 10.0f; }
+
+// Indicators form a small dependency graph: an indicator is computed either from the kline or from one input series,
+// itself an indicator (RSI -> StochRSI -> %K -> %D, triple EMA -> percent change -> TRIX, median price -> AO).
+// indicator_input() gives that input, false for the indicators computed from the kline
+bool indicator_input(const INDICATOR_SPEC &spec, INDICATOR_SPEC &input);
+// writes the kline.nb values of spec into out, from input (the values of indicator_input(spec)) when it has one
+void compute_indicator(const KLINEf &kline, const INDICATOR_SPEC &spec, const float *input, float *out);
+// same, computing the input first
+std::vector<float> compute_indicator(const KLINEf &kline, const INDICATOR_SPEC &spec);
+// true when a and b can be computed together by compute_indicators(): EMAs, Williams %R, SuperTrend directions, and
+// raw StochRSI on the same RSI period. Then they also have the same input
+bool same_indicator_batch(const INDICATOR_SPEC &a, const INDICATOR_SPEC &b);
+// compute_indicator() of specs of one batch, out[j] for specs[j] (EMA_BATCH, WILLR_BATCH, STOCHRSI_BATCH, SuperTrend
+// on a shared true range)
+void compute_indicators(const KLINEf &kline, const std::vector<INDICATOR_SPEC> &specs, const float *input, float *const *out);
+
+// reduced-precision storage of an indicator column (see INDICATOR_REGISTRY::encoding)
+enum COLUMN_ENCODING : uint8_t
+{
+    ENC_FLOAT32, // no compaction
+    ENC_FP16,    // half floats of x / scale, scale = power of 2 above the largest |x|
+    ENC_BF16,    // top 16 bits of the floats x
+    ENC_INT16    // x = base + q * scale, base and scale spanning the column
+};
+
+struct COMPACT_COLUMN
+{
+    COLUMN_ENCODING encoding = ENC_FLOAT32;
+    float base = 0.0f;
+    float scale = 1.0f;
+    bool relative = false; // x = value / reference - 1, otherwise x = value
+    std::vector<uint16_t> bits;
+};
+
+COMPACT_COLUMN encode_column(const std::vector<float> &values, const COLUMN_ENCODING encoding, const float *reference = nullptr);
+void decode_column(const COMPACT_COLUMN &column, float *out, const float *reference = nullptr);
+// the close for the price-level indicators (EMA, SMA), nullptr for the others
+const float *compact_reference(const KLINEf &kline, const INDICATOR_SPEC &spec);
+// what a strategy compares the columns of one indicator kind with (see INDICATOR_REGISTRY::decisions)
+struct COLUMN_DECISIONS
+{
+    bool close = false;        // the close (close >= EMA)
+    bool input = false;        // the input of the column (%K against %D, %K being the input of %D)
+    std::vector<float> levels; // thresholds (%D < STOCH_RSI_LOWER, TRIX > 0)
+};
+// true when each of the decisions is the same with the decoded values as with the exact ones, on every bar (which
+// covers crossovers: they are the sides on bars ii - 1 and ii). Equality counts as a side of its own, so that both
+// < and <= tests are covered. input holds the exact values of the column's input.
+// A comparison with another column of the registry (EMA against EMA) cannot be checked here, the exact values of the
+// other column being gone by then: the kinds compared that way are not declared, and stay in float
+bool compact_column_agrees(const KLINEf &kline, const COLUMN_DECISIONS &decisions, const std::vector<float> &exact,
+                           const std::vector<float> &decoded, const float *input);
+
+// 64-bit hash of the columns of kline as they are used (after align_pairs), which keys its stored indicators
+uint64_t kline_fingerprint(const KLINEf &kline);
+
+const std::string INDICATOR_STORE_DIR = "./data/indicators";
+const size_t INDICATOR_STORE_BYTES = size_t(4) << 30; // beyond it, the least recently used stored indicators are deleted
+
+// indicators of one pair, resolved once to integer handles so that the bar loops index plain arrays.
+// The registry can be shared by backtests running on several threads:
+// - an indicator is computed once, by the first thread resolving its spec; the threads resolving the same spec
+//   meanwhile wait for that computation instead of repeating it
+// - after that, resolve() and span() take no lock (insert-only open addressing table with atomic keys)
+// With a byte budget (budget_bytes > 0), indicators that are not pinned can be evicted to stay under it:
+// - acquire() pins an indicator and release() unpins it; a span is only valid between the two
+// - the victim is the unpinned indicator with the lowest GreedyDual priority: the inflation value at its last
+//   acquire plus the time it took to compute. Without compute cost differences this is LRU; with them, a StochRSI
+//   stays resident longer than an EMA. All the columns of a pair have the same size, so it does not enter the priority
+// - an evicted indicator keeps its handle and is computed again on its next acquire
+// An indicator with an input (see indicator_input) is derived from the registry's copy of that input, so the
+// intermediate series are computed once per pair and shared: all the TRIX of one length use the same triple EMA
+// and percent change.
+// Without a budget nothing is evicted, and handles and spans from resolve() stay valid for the life of the registry.
+// After store_in(dir, kline), computed indicators are also written to "<dir>/<kline fingerprint>-<spec>.ind", and later
+// runs on the same data map those files read-only instead of computing them again. The inputs of other indicators are
+// not stored, and the first store_in() of a run trims the store to INDICATOR_STORE_BYTES, least recently used first.
+// With encoding != ENC_FLOAT32, the computed columns of the kinds listed in decisions are kept compact when
+// compact_column_agrees() accepts them (the bar loops then read the decoded values), and in float otherwise. The other
+// kinds, ATR and the inputs of other indicators always stay in float.
+// Under a budget, the decoded floats of unpinned compact columns are dropped before any indicator is evicted, so the
+// resident set is mostly 2 bytes per value
+struct INDICATOR_REGISTRY
+{
+    static const uint CAPACITY = 4096; // distinct specs per pair, a power of 2
+
+    struct SLOT
+    {
+        std::atomic<uint64_t> key{0}; // packed spec + 1, 0 while the slot is free
+        std::atomic<const float *> data{nullptr};
+        std::atomic<uint> pins{0};
+        std::atomic<uint64_t> cost_ns{0};  // time of the last computation
+        std::atomic<uint64_t> priority{0}; // GreedyDual priority, lowest is evicted first
+        std::mutex lock;                   // held while computing or evicting
+        std::vector<float> values;
+        void *map = nullptr; // mapped store file, used instead of values
+        size_t map_size = 0;
+        COMPACT_COLUMN compact;
+        std::atomic<size_t> bytes{0}; // held by values, map and compact
+        std::atomic<bool> compact_resident{false};
+    };
+    std::unique_ptr<SLOT[]> slots{new SLOT[CAPACITY]};
+
+    size_t budget_bytes = 0;                // 0: unlimited; set before the registry is shared
+    COLUMN_ENCODING encoding = ENC_FLOAT32; // same
+    std::map<INDICATOR_KIND, COLUMN_DECISIONS> decisions; // same: what the strategy compares each compacted kind with
+    std::atomic<size_t> used_bytes{0};
+    std::atomic<uint64_t> inflation{0}; // priority of the last victim
+    std::atomic<uint> nb_computed{0};
+    std::atomic<uint> nb_evicted{0};
+    std::atomic<uint> nb_loaded{0};     // read from the store instead of computed
+    std::atomic<uint> nb_kept_exact{0}; // rejected by compact_column_agrees()
+    std::mutex evict_lock;
+
+    std::string store_dir; // empty: no persistent store
+    uint64_t fingerprint = 0;
+
+    INDICATOR_REGISTRY() = default;
+    ~INDICATOR_REGISTRY();
+
+    // set before the registry is shared, once kline is final
+    void store_in(const std::string &dir, const KLINEf &kline);
+
+    uint resolve(const KLINEf &kline, const INDICATOR_SPEC &spec);
+    // resolves all the specs, computing the missing ones of a batch (see same_indicator_batch) in one pass. Under a
+    // budget the columns are not pinned, so this only prepares the acquire() calls that follow
+    std::vector<uint> resolve(const KLINEf &kline, const std::vector<INDICATOR_SPEC> &specs);
+    uint acquire(const KLINEf &kline, const INDICATOR_SPEC &spec);
+    void release(const uint handle) { slots[handle].pins.fetch_sub(1); }
+    const float *span(const uint handle) const { return slots[handle].data.load(std::memory_order_acquire); }
+    // resolve() then span(), without a budget only (nothing pins the indicator)
+    const float *span(const KLINEf &kline, const INDICATOR_SPEC &spec);
+
+private:
+    uint find_slot(const uint64_t key);
+    bool restore(SLOT &slot, const KLINEf &kline, const INDICATOR_SPEC &spec);
+    void compute(SLOT &slot, const KLINEf &kline, const INDICATOR_SPEC &spec);
+    void compute_batch(const KLINEf &kline, const std::vector<uint> &batch, const std::vector<INDICATOR_SPEC> &specs);
+    void publish_computed(SLOT &slot, const KLINEf &kline, const INDICATOR_SPEC &spec, const std::chrono::steady_clock::time_point t0);
+    void publish(SLOT &slot, const KLINEf &kline, const INDICATOR_SPEC &spec, const float *data, const std::chrono::steady_clock::time_point t0);
+    const float *compact(SLOT &slot, const KLINEf &kline, const INDICATOR_SPEC &spec, const float *exact);
+    void evict_over_budget();
+    bool try_evict(SLOT &slot, const bool demote);
+    void account(SLOT &slot);
+    std::string stored_path(const uint64_t packed_spec) const;
+    bool load_stored(SLOT &slot, const uint64_t packed_spec, const uint nb);
+    void write_stored(const SLOT &slot, const uint64_t packed_spec) const;
+};
@@ -1,4 +1,12 @@
 #include "tools.hh"
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <cstring>
+#include <thread>
+#include <atomic>
+#include <charconv>
+#include <iterator>
 
 //////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
@@ -228,62 +236,92 @@ int find_max(const std::vector<int> &vec)
 }
 //////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
-int get_hour_from_timestamp(const int timestamp)
+CIVIL_TIME civil_from_timestamp(const int timestamp)
 {
-    time_t rawtime = timestamp;
-    struct tm ts;
-    char buf[80];
-
-    // Format time, "ddd yyyy-mm-dd hh:mm:ss zzz" ->  "%a %Y-%m-%d %H:%M:%S %Z"
-    ts = *localtime(&rawtime);
-    strftime(buf, sizeof(buf), "%H", &ts);
+    // floor division, so that timestamps before 1970 land on the previous day
+    int64_t days = timestamp / 86400;
+    int64_t seconds = timestamp % 86400;
+    if (seconds < 0)
+    {
+        seconds += 86400;
+        days--;
+    }
 
-    return std::stoi(buf);
+    // days -> civil date in the proleptic Gregorian calendar (H. Hinnant's civil_from_days),
+    // with years starting on March 1st so that the leap day is the last day of the year
+    days += 719468; // days from 0000-03-01 to 1970-01-01
+    const int64_t era = (days >= 0 ? days : days - 146096) / 146097;
+    const uint day_of_era = uint(days - era * 146097);                                                      // [0, 146096]
+    const uint year_of_era = (day_of_era - day_of_era / 1460 + day_of_era / 36524 - day_of_era / 146096) / 365; // [0, 399]
+    const uint day_of_year = day_of_era - (365 * year_of_era + year_of_era / 4 - year_of_era / 100);         // [0, 365]
+    const uint month_from_march = (5 * day_of_year + 2) / 153;                                               // [0, 11]
+
+    CIVIL_TIME civil;
+    civil.day = int(day_of_year - (153 * month_from_march + 2) / 5 + 1);
+    civil.month = int(month_from_march < 10 ? month_from_march + 3 : month_from_march - 9);
+    civil.year = int(int64_t(year_of_era) + era * 400) + (civil.month <= 2 ? 1 : 0);
+    civil.hour = int(seconds / 3600);
+    return civil;
 }
 
 //////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
-int get_year_from_timestamp(const int timestamp)
+CALENDAR_INDEX build_calendar_index(const std::vector<uint> &timestamp)
 {
-    time_t rawtime = timestamp;
-    struct tm ts;
-    char buf[80];
+    const uint FUNDING_PERIOD = 8 * 3600;
+
+    CALENDAR_INDEX calendar;
+    calendar.flags.resize(timestamp.size());
+    calendar.month_id.resize(timestamp.size());
+    calendar.day.resize(timestamp.size());
 
-    // Format time, "ddd yyyy-mm-dd hh:mm:ss zzz"
-    ts = *localtime(&rawtime);
-    strftime(buf, sizeof(buf), "%Y", &ts);
+    for (uint ii = 0; ii < timestamp.size(); ii++)
+    {
+        const CIVIL_TIME civil = civil_from_timestamp(timestamp[ii]);
+        calendar.month_id[ii] = uint16_t((civil.year - 1970) * 12 + civil.month - 1);
+        calendar.day[ii] = uint8_t(civil.day);
+
+        if (ii == 0)
+        {
+            calendar.flags[ii] = CAL_NEW_DAY | CAL_NEW_MONTH | CAL_NEW_YEAR | CAL_FUNDING;
+            continue;
+        }
+
+        uint8_t flags = 0;
+        if (timestamp[ii] / 86400 != timestamp[ii - 1] / 86400)
+            flags |= CAL_NEW_DAY;
+        if (calendar.month_id[ii] != calendar.month_id[ii - 1])
+            flags |= CAL_NEW_MONTH;
+        if (calendar.year(ii) != calendar.year(ii - 1))
+            flags |= CAL_NEW_YEAR;
+        if (timestamp[ii] / FUNDING_PERIOD != timestamp[ii - 1] / FUNDING_PERIOD)
+            flags |= CAL_FUNDING;
+        calendar.flags[ii] = flags;
+    }
 
-    return std::stoi(buf);
+    return calendar;
 }
 
 //////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
-int get_month_from_timestamp(const int timestamp)
+int get_hour_from_timestamp(const int timestamp)
 {
-    time_t rawtime = timestamp;
-    struct tm ts;
-    char buf[80];
-
-    // Format time, "ddd yyyy-mm-dd hh:mm:ss zzz"
-    ts = *localtime(&rawtime);
-    strftime(buf, sizeof(buf), "%m", &ts);
+    return civil_from_timestamp(timestamp).hour;
+}
 
-    return std::stoi(buf);
+int get_year_from_timestamp(const int timestamp)
+{
+    return civil_from_timestamp(timestamp).year;
 }
 
-//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+int get_month_from_timestamp(const int timestamp)
+{
+    return civil_from_timestamp(timestamp).month;
+}
 
 int get_day_from_timestamp(const int timestamp)
 {
-    time_t rawtime = timestamp;
-    struct tm ts;
-    char buf[80];
-
-    // Format time, "ddd yyyy-mm-dd hh:mm:ss zzz"
-    ts = *localtime(&rawtime);
-    strftime(buf, sizeof(buf), "%d", &ts);
-
-    return std::stoi(buf);
+    return civil_from_timestamp(timestamp).day;
 }
 
 //////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -383,34 +421,1087 @@ std::string ReplaceAll(std::string str, const std::string &from, const std::stri
 
 //////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
-float calculate_calmar_ratio(const std::vector<int> &times, const std::vector<float> &wallet_vals, const float &max_DD)
+// parses one number of the field starting at p and checks that it is followed by sep (or ends at eol when sep == 0).
+// std::from_chars neither allocates nor depends on the locale, and never reads past eol.
+template <typename T>
+static inline bool parse_kline_field(const char *&p, const char *eol, T &val, const char sep)
+{
+    const std::from_chars_result res = std::from_chars(p, eol, val);
+    if (res.ec != std::errc() || res.ptr == p)
+        return false;
+    p = res.ptr;
+    if (sep == 0)
+        return p == eol || *p == '\r';
+    if (p == eol || *p != sep)
+        return false;
+    p++;
+    return true;
+}
+
+// moves past the field starting at p without converting it
+static inline bool skip_kline_field(const char *&p, const char *eol, const char sep)
+{
+    if (sep == 0)
+        return p != eol;
+    const char *q = static_cast<const char *>(memchr(p, sep, eol - p));
+    if (q == nullptr || q == p)
+        return false;
+    p = q + 1;
+    return true;
+}
+
+// parses one "ts;open;high;low;close;volume" line in [p, eol). The timestamp is always parsed (it drives the duplicate
+// check); the price / volume fields outside columns are skipped, vals[k] holds the field of column COL_OPEN + k.
+static bool parse_kline_line(const char *p, const char *eol, const KLINE_COLUMNS columns, long int &ts, float vals[NB_KLINE_COLUMNS - 1])
+{
+    if (!parse_kline_field(p, eol, ts, ';'))
+        return false;
+    for (uint col = COL_OPEN; col < NB_KLINE_COLUMNS; col++)
+    {
+        const char sep = col == COL_VOLUME ? 0 : ';';
+        const bool ok = (columns & (1u << col)) ? parse_kline_field(p, eol, vals[col - COL_OPEN], sep) : skip_kline_field(p, eol, sep);
+        if (!ok)
+            return false;
+    }
+    return true;
+}
+
+// float column col (COL_OPEN ... COL_VOLUME) of kline
+static inline std::vector<float> &kline_float_column(KLINEf &kline, const uint col)
+{
+    switch (col)
+    {
+    case COL_OPEN:
+        return kline.open;
+    case COL_HIGH:
+        return kline.high;
+    case COL_LOW:
+        return kline.low;
+    case COL_CLOSE:
+        return kline.close;
+    default:
+        return kline.volume;
+    }
+}
+
+// frees the columns of kline that are not in columns
+static void project_kline_columns(KLINEf &kline, const KLINE_COLUMNS columns)
+{
+    if (!(columns & KLINE_TIMESTAMP))
+        std::vector<uint>().swap(kline.timestamp);
+    for (uint col = COL_OPEN; col < NB_KLINE_COLUMNS; col++)
+    {
+        if (!(columns & (1u << col)))
+            std::vector<float>().swap(kline_float_column(kline, col));
+    }
+}
+
+static KLINEf parse_kline_csv(const std::string &input_file_path, const KLINE_COLUMNS columns, struct stat &st)
+{
+    KLINEf kline;
+    kline.nb = 0;
+
+    const int fd = open(input_file_path.c_str(), O_RDONLY);
+    if (fd < 0)
+    {
+        std::cout << "ERROR: cannot open data file " << input_file_path << std::endl;
+        std::abort();
+    }
+
+    if (fstat(fd, &st) != 0)
+    {
+        std::cout << "ERROR: cannot stat data file " << input_file_path << std::endl;
+        std::abort();
+    }
+
+    const size_t size = st.st_size;
+    if (size == 0)
+    {
+        close(fd);
+        return kline;
+    }
+
+    void *map = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED)
+    {
+        std::cout << "ERROR: cannot mmap data file " << input_file_path << std::endl;
+        std::abort();
+    }
+    madvise(map, size, MADV_SEQUENTIAL);
+
+    const char *begin = static_cast<const char *>(map);
+    const char *end = begin + size;
+
+    // one bar per line: count them first so that every loaded column is allocated exactly once
+    size_t nb_lines = 0;
+    for (const char *p = begin; (p = static_cast<const char *>(memchr(p, '\n', end - p))) != nullptr; p++)
+        nb_lines++;
+    nb_lines++;
+
+    if (columns & KLINE_TIMESTAMP)
+        kline.timestamp.reserve(nb_lines);
+    for (uint col = COL_OPEN; col < NB_KLINE_COLUMNS; col++)
+    {
+        if (columns & (1u << col))
+            kline_float_column(kline, col).reserve(nb_lines);
+    }
+
+    long int ts, previous_ts = -1;
+    float vals[NB_KLINE_COLUMNS - 1];
+    uint nb_read = 0;
+    const char *p = begin;
+    while (p < end)
+    {
+        const char *eol = static_cast<const char *>(memchr(p, '\n', end - p));
+        if (eol == nullptr)
+            eol = end; // last line without trailing newline
+        const bool ok = parse_kline_line(p, eol, columns, ts, vals);
+        const bool empty_line = (eol == p) || (eol - p == 1 && *p == '\r');
+        p = eol + 1;
+
+        if (!ok)
+        {
+            if (!empty_line)
+                std::cout << "WARNING: malformed line at index " + std::to_string(nb_read) + " in " + input_file_path + "; IGNORING.\n";
+            continue;
+        }
+        if (ts == previous_ts)
+        {
+            std::cout << "FOUND DUPLICATE TS at index " + std::to_string(nb_read) + " in " + input_file_path + "; IGNORING.\n";
+            continue;
+        }
+        previous_ts = ts;
+
+        if (columns & KLINE_TIMESTAMP)
+            kline.timestamp.push_back(ts / 1000);
+        for (uint col = COL_OPEN; col < NB_KLINE_COLUMNS; col++)
+        {
+            if (columns & (1u << col))
+                kline_float_column(kline, col).push_back(vals[col - COL_OPEN]);
+        }
+        nb_read++;
+    }
+
+    munmap(map, size);
+
+    kline.nb = nb_read;
+
+    return kline;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+// Binary sidecar written next to each csv ("<file>.csv.bin"):
+// header, then the columns one after the other: uint32 timestamp[nb], float open[nb], high[nb], low[nb], close[nb], volume[nb]
+static const char KLINE_CACHE_MAGIC[8] = {'K', 'L', 'I', 'N', 'E', 'B', 'I', 'N'};
+static const uint32_t KLINE_CACHE_VERSION = 1;
+static const uint KLINE_CACHE_NB_COLUMNS = 6;
+
+struct KLINE_CACHE_HEADER
+{
+    char magic[8];
+    uint32_t version;
+    uint32_t timeframe; // seconds between two bars
+    uint64_t nb;        // number of bars
+    uint64_t source_size;
+    int64_t source_mtime_ns;
+    uint8_t padding[24]; // keeps the columns 64 bytes aligned
+};
+static_assert(sizeof(KLINE_CACHE_HEADER) == 64, "unexpected KLINE_CACHE_HEADER size");
+
+std::string kline_cache_path(const std::string &input_file_path)
+{
+    return input_file_path + ".bin";
+}
+
+static int64_t mtime_ns(const struct stat &st)
+{
+    return int64_t(st.st_mtim.tv_sec) * 1000000000 + int64_t(st.st_mtim.tv_nsec);
+}
+
+static bool read_kline_cache(const std::string &cache_path, const struct stat &source_st, KLINEf &kline, const KLINE_COLUMNS columns)
+{
+    const int fd = open(cache_path.c_str(), O_RDONLY);
+    if (fd < 0)
+        return false;
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || size_t(st.st_size) < sizeof(KLINE_CACHE_HEADER))
+    {
+        close(fd);
+        return false;
+    }
+
+    void *map = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED)
+        return false;
+
+    const KLINE_CACHE_HEADER *header = static_cast<const KLINE_CACHE_HEADER *>(map);
+    const bool valid = memcmp(header->magic, KLINE_CACHE_MAGIC, sizeof(KLINE_CACHE_MAGIC)) == 0 &&
+                       header->version == KLINE_CACHE_VERSION &&
+                       header->source_size == uint64_t(source_st.st_size) &&
+                       header->source_mtime_ns == mtime_ns(source_st) &&
+                       uint64_t(st.st_size) == sizeof(KLINE_CACHE_HEADER) + KLINE_CACHE_NB_COLUMNS * header->nb * 4;
+
+    if (valid)
+    {
+        // only the pages of the requested columns are touched
+        const size_t nb = header->nb;
+        const uint32_t *ts = reinterpret_cast<const uint32_t *>(header + 1);
+        const float *float_columns = reinterpret_cast<const float *>(ts + nb);
+
+        if (columns & KLINE_TIMESTAMP)
+            kline.timestamp.assign(ts, ts + nb);
+        for (uint col = COL_OPEN; col < NB_KLINE_COLUMNS; col++)
+        {
+            if (columns & (1u << col))
+            {
+                const float *column = float_columns + (col - COL_OPEN) * nb;
+                kline_float_column(kline, col).assign(column, column + nb);
+            }
+        }
+        kline.nb = nb;
+    }
+
+    munmap(map, st.st_size);
+    return valid;
+}
+
+// kline must hold every column
+static void write_kline_cache(const std::string &cache_path, const struct stat &source_st, const KLINEf &kline)
+{
+    KLINE_CACHE_HEADER header{};
+    memcpy(header.magic, KLINE_CACHE_MAGIC, sizeof(KLINE_CACHE_MAGIC));
+    header.version = KLINE_CACHE_VERSION;
+    header.nb = kline.nb;
+    header.source_size = source_st.st_size;
+    header.source_mtime_ns = mtime_ns(source_st);
+
+    // timeframe = smallest step between two bars (gaps in the data only make steps larger)
+    uint timeframe = 0;
+    for (uint ii = 1; ii < kline.nb; ii++)
+    {
+        const uint delta = kline.timestamp[ii] - kline.timestamp[ii - 1];
+        if (delta > 0 && (timeframe == 0 || delta < timeframe))
+            timeframe = delta;
+    }
+    header.timeframe = timeframe;
+
+    // write to a temporary file and rename it, so that concurrent runs never map a half-written cache
+    const std::string tmp_path = cache_path + ".tmp" + std::to_string(getpid());
+    std::ofstream out(tmp_path, std::ios::binary | std::ios::trunc);
+    if (!out.is_open())
+    {
+        std::cout << "WARNING: cannot write data cache " << cache_path << std::endl;
+        return;
+    }
+
+    const std::streamsize column_bytes = std::streamsize(kline.nb) * 4;
+    out.write(reinterpret_cast<const char *>(&header), sizeof(header));
+    out.write(reinterpret_cast<const char *>(kline.timestamp.data()), column_bytes);
+    out.write(reinterpret_cast<const char *>(kline.open.data()), column_bytes);
+    out.write(reinterpret_cast<const char *>(kline.high.data()), column_bytes);
+    out.write(reinterpret_cast<const char *>(kline.low.data()), column_bytes);
+    out.write(reinterpret_cast<const char *>(kline.close.data()), column_bytes);
+    out.write(reinterpret_cast<const char *>(kline.volume.data()), column_bytes);
+    out.close();
+
+    if (!out || rename(tmp_path.c_str(), cache_path.c_str()) != 0)
+    {
+        std::cout << "WARNING: cannot write data cache " << cache_path << std::endl;
+        unlink(tmp_path.c_str());
+    }
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+// Compressed store "<pair>.klz": header, then one bit stream per column (most significant bit first, 64-bit words).
+// timestamps: first value, first delta, then delta-of-deltas with the Gorilla prefix codes '0', '10', '110', '1110', '1111'
+// floats: Gorilla XOR with the previous value of the column ('0' = same value, '10' = meaningful bits inside the previous
+// window, '11' + 5 bits leading zeros + 5 bits (length - 1) + meaningful bits). open is XORed with the previous close,
+// which it nearly always equals, so it mostly costs one bit per bar.
+static const char KLINE_GORILLA_MAGIC[8] = {'K', 'L', 'I', 'N', 'E', 'G', 'O', 'R'};
+static const uint32_t KLINE_GORILLA_VERSION = 1;
+
+struct KLINE_GORILLA_HEADER
+{
+    char magic[8];
+    uint32_t version;
+    uint32_t nb_columns;
+    uint64_t nb;
+    uint64_t column_offset[NB_KLINE_COLUMNS]; // in 64-bit words from the end of the header
+    uint64_t column_words[NB_KLINE_COLUMNS];
+};
+
+class BIT_WRITER
+{
+public:
+    std::vector<uint64_t> words;
+
+    // nb_bits <= 32
+    inline void write(const uint64_t bits, const uint nb_bits)
+    {
+        if (nb_bits == 0)
+            return;
+        const uint free_bits = 64 - used;
+        if (nb_bits <= free_bits)
+        {
+            current |= bits << (free_bits - nb_bits);
+            used += nb_bits;
+        }
+        else
+        {
+            const uint rest = nb_bits - free_bits;
+            current |= bits >> rest;
+            words.push_back(current);
+            current = bits << (64 - rest);
+            used = rest;
+        }
+        if (used == 64)
+        {
+            words.push_back(current);
+            current = 0;
+            used = 0;
+        }
+    }
+
+    void flush()
+    {
+        if (used > 0)
+            words.push_back(current);
+        words.push_back(0); // lets BIT_READER always load the next word
+        current = 0;
+        used = 0;
+    }
+
+private:
+    uint64_t current = 0;
+    uint used = 0;
+};
+
+class BIT_READER
+{
+public:
+    // set when a read runs past the stream or a decoder finds an impossible code; reads then return 0
+    bool invalid = false;
+
+    // nb_words includes the zero word BIT_WRITER::flush appends, so read() can always load the next word
+    BIT_READER(const uint64_t *words, const uint64_t nb_words) : words(words), nb_words(nb_words) {}
+
+    // nb_bits <= 32
+    inline uint64_t read(const uint nb_bits)
+    {
+        if (nb_bits == 0)
+            return 0;
+        if (pos + nb_bits > (nb_words - 1) * 64)
+        {
+            invalid = true;
+            return 0;
+        }
+        const uint64_t *word = words + (pos >> 6);
+        const uint offset = pos & 63;
+        uint64_t bits = word[0] << offset;
+        if (offset + nb_bits > 64)
+            bits |= word[1] >> (64 - offset);
+        pos += nb_bits;
+        return bits >> (64 - nb_bits);
+    }
+
+    inline bool read_bit() { return read(1) != 0; }
+
+    // the whole stream was decoded, no more and no less than what BIT_WRITER wrote
+    bool complete() const { return !invalid && (pos + 63) / 64 + 1 == nb_words; }
+
+private:
+    const uint64_t *words;
+    const uint64_t nb_words;
+    uint64_t pos = 0;
+};
+
+static void encode_timestamps(BIT_WRITER &out, const std::vector<uint> &timestamp, const size_t nb)
+{
+    if (nb == 0)
+        return;
+    out.write(timestamp[0], 32);
+    if (nb == 1)
+        return;
+    int64_t prev_delta = int64_t(timestamp[1]) - int64_t(timestamp[0]);
+    out.write(uint32_t(prev_delta), 32);
+
+    for (size_t ii = 2; ii < nb; ii++)
+    {
+        const int64_t delta = int64_t(timestamp[ii]) - int64_t(timestamp[ii - 1]);
+        const int64_t dod = delta - prev_delta;
+        prev_delta = delta;
+
+        if (dod == 0)
+            out.write(0b0, 1);
+        else if (dod >= -63 && dod <= 64)
+        {
+            out.write(0b10, 2);
+            out.write(uint64_t(dod + 63), 7);
+        }
+        else if (dod >= -255 && dod <= 256)
+        {
+            out.write(0b110, 3);
+            out.write(uint64_t(dod + 255), 9);
+        }
+        else if (dod >= -2047 && dod <= 2048)
+        {
+            out.write(0b1110, 4);
+            out.write(uint64_t(dod + 2047), 12);
+        }
+        else
+        {
+            out.write(0b1111, 4);
+            out.write(uint32_t(dod), 32);
+        }
+    }
+}
+
+static void decode_timestamps(BIT_READER &in, std::vector<uint> &timestamp, const size_t nb)
+{
+    timestamp.resize(nb);
+    if (nb == 0)
+        return;
+    timestamp[0] = in.read(32);
+    if (nb == 1)
+        return;
+    int64_t delta = int32_t(in.read(32));
+    timestamp[1] = uint(timestamp[0] + delta);
+
+    for (size_t ii = 2; ii < nb; ii++)
+    {
+        int64_t dod;
+        if (!in.read_bit())
+            dod = 0;
+        else if (!in.read_bit())
+            dod = int64_t(in.read(7)) - 63;
+        else if (!in.read_bit())
+            dod = int64_t(in.read(9)) - 255;
+        else if (!in.read_bit())
+            dod = int64_t(in.read(12)) - 2047;
+        else
+            dod = int32_t(in.read(32));
+        delta += dod;
+        timestamp[ii] = uint(timestamp[ii - 1] + delta);
+    }
+}
+
+struct XOR_WINDOW
+{
+    uint leading = 32; // 32 = no window yet
+    uint trailing = 0;
+};
+
+static inline uint32_t float_bits(const float val)
+{
+    uint32_t bits;
+    memcpy(&bits, &val, 4);
+    return bits;
+}
+
+static inline float bits_float(const uint32_t bits)
+{
+    float val;
+    memcpy(&val, &bits, 4);
+    return val;
+}
+
+static inline void encode_xor(BIT_WRITER &out, const uint32_t x, XOR_WINDOW &window)
+{
+    if (x == 0)
+    {
+        out.write(0b0, 1);
+        return;
+    }
+    const uint leading = __builtin_clz(x);
+    const uint trailing = __builtin_ctz(x);
+    if (window.leading < 32 && leading >= window.leading && trailing >= window.trailing)
+    {
+        out.write(0b10, 2);
+        out.write(x >> window.trailing, 32 - window.leading - window.trailing);
+    }
+    else
+    {
+        const uint length = 32 - leading - trailing;
+        out.write(0b11, 2);
+        out.write(leading, 5);
+        out.write(length - 1, 5);
+        out.write(x >> trailing, length);
+        window.leading = leading;
+        window.trailing = trailing;
+    }
+}
+
+static inline uint32_t decode_xor(BIT_READER &in, XOR_WINDOW &window)
+{
+    if (!in.read_bit())
+        return 0;
+    if (in.read_bit())
+    {
+        window.leading = in.read(5);
+        const uint length = in.read(5) + 1;
+        if (window.leading + length > 32)
+        {
+            in.invalid = true;
+            window.leading = 32;
+            window.trailing = 0;
+            return 0;
+        }
+        window.trailing = 32 - window.leading - length;
+    }
+    return uint32_t(in.read(32 - window.leading - window.trailing)) << window.trailing;
+}
+
+// reference = nullptr: XOR with the previous value of the column; otherwise with reference[ii - 1]
+static void encode_floats(BIT_WRITER &out, const std::vector<float> &column, const std::vector<float> *reference, const size_t nb)
+{
+    XOR_WINDOW window;
+    uint32_t prev = 0;
+    for (size_t ii = 0; ii < nb; ii++)
+    {
+        const uint32_t bits = float_bits(column[ii]);
+        encode_xor(out, bits ^ prev, window);
+        prev = reference == nullptr ? bits : float_bits((*reference)[ii]);
+    }
+}
+
+static void decode_floats(BIT_READER &in, std::vector<float> &column, const std::vector<float> *reference, const size_t nb)
+{
+    column.resize(nb);
+    XOR_WINDOW window;
+    uint32_t prev = 0;
+    for (size_t ii = 0; ii < nb; ii++)
+    {
+        const uint32_t bits = decode_xor(in, window) ^ prev;
+        if ((bits & 0x7f800000) == 0x7f800000) // nan or inf: csv data never holds those
+            in.invalid = true;
+        column[ii] = bits_float(bits);
+        prev = reference == nullptr ? bits : float_bits((*reference)[ii]);
+    }
+}
+
+std::string kline_compressed_path(const std::string &input_file_path)
+{
+    const std::string ext = ".csv";
+    if (input_file_path.size() > ext.size() && input_file_path.compare(input_file_path.size() - ext.size(), ext.size(), ext) == 0)
+        return input_file_path.substr(0, input_file_path.size() - ext.size()) + ".klz";
+    return input_file_path + ".klz";
+}
+
+// kline must hold every column
+static bool write_kline_compressed(const std::string &compressed_path, const KLINEf &kline)
+{
+    const size_t nb = kline.nb;
+    BIT_WRITER streams[NB_KLINE_COLUMNS];
+    encode_timestamps(streams[COL_TIMESTAMP], kline.timestamp, nb);
+    encode_floats(streams[COL_OPEN], kline.open, &kline.close, nb);
+    encode_floats(streams[COL_HIGH], kline.high, nullptr, nb);
+    encode_floats(streams[COL_LOW], kline.low, nullptr, nb);
+    encode_floats(streams[COL_CLOSE], kline.close, nullptr, nb);
+    encode_floats(streams[COL_VOLUME], kline.volume, nullptr, nb);
+
+    KLINE_GORILLA_HEADER header{};
+    memcpy(header.magic, KLINE_GORILLA_MAGIC, sizeof(KLINE_GORILLA_MAGIC));
+    header.version = KLINE_GORILLA_VERSION;
+    header.nb_columns = NB_KLINE_COLUMNS;
+    header.nb = nb;
+    uint64_t offset = 0;
+    for (uint col = 0; col < NB_KLINE_COLUMNS; col++)
+    {
+        streams[col].flush();
+        header.column_offset[col] = offset;
+        header.column_words[col] = streams[col].words.size();
+        offset += streams[col].words.size();
+    }
+
+    const std::string tmp_path = compressed_path + ".tmp" + std::to_string(getpid());
+    std::ofstream out(tmp_path, std::ios::binary | std::ios::trunc);
+    if (!out.is_open())
+        return false;
+    out.write(reinterpret_cast<const char *>(&header), sizeof(header));
+    for (uint col = 0; col < NB_KLINE_COLUMNS; col++)
+    {
+        out.write(reinterpret_cast<const char *>(streams[col].words.data()), std::streamsize(streams[col].words.size()) * 8);
+    }
+    out.close();
+
+    if (!out || rename(tmp_path.c_str(), compressed_path.c_str()) != 0)
+    {
+        unlink(tmp_path.c_str());
+        return false;
+    }
+    return true;
+}
+
+KLINEf read_kline_compressed(const std::string &compressed_path, const KLINE_COLUMNS columns)
+{
+    KLINEf kline;
+    kline.nb = 0;
+
+    const int fd = open(compressed_path.c_str(), O_RDONLY);
+    struct stat st;
+    if (fd < 0 || fstat(fd, &st) != 0)
+    {
+        std::cout << "ERROR: cannot open compressed data file " << compressed_path << std::endl;
+        std::abort();
+    }
+    void *map = size_t(st.st_size) >= sizeof(KLINE_GORILLA_HEADER) ? mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0) : MAP_FAILED;
+    close(fd);
+
+    const KLINE_GORILLA_HEADER *header = static_cast<const KLINE_GORILLA_HEADER *>(map);
+    bool valid = map != MAP_FAILED &&
+                 memcmp(header->magic, KLINE_GORILLA_MAGIC, sizeof(KLINE_GORILLA_MAGIC)) == 0 &&
+                 header->version == KLINE_GORILLA_VERSION &&
+                 header->nb_columns == NB_KLINE_COLUMNS;
+    for (uint col = 0; valid && col < NB_KLINE_COLUMNS; col++)
+    {
+        // every value costs at least one bit, which bounds nb before anything is allocated
+        valid = header->column_words[col] >= 1 &&
+                header->column_words[col] <= uint64_t(st.st_size) / 8 &&
+                header->column_offset[col] <= uint64_t(st.st_size) / 8 &&
+                sizeof(KLINE_GORILLA_HEADER) + (header->column_offset[col] + header->column_words[col]) * 8 <= uint64_t(st.st_size) &&
+                header->nb <= header->column_words[col] * 64;
+    }
+    auto invalid_file = [&]()
+    {
+        std::cout << "ERROR: invalid compressed data file " << compressed_path << std::endl;
+        std::abort();
+    };
+    if (!valid)
+        invalid_file();
+    madvise(map, st.st_size, MADV_SEQUENTIAL);
+
+    // each requested column is decoded in one pass straight into its vector, the others are not read at all.
+    // close comes before open, which refers to it (and is dropped again if it was only needed for that).
+    const size_t nb = header->nb;
+    const uint64_t *words = reinterpret_cast<const uint64_t *>(header + 1);
+    auto stream = [&](const KLINE_COLUMN col)
+    { return BIT_READER(words + header->column_offset[col], header->column_words[col]); };
+
+    if (columns & KLINE_TIMESTAMP)
+    {
+        BIT_READER ts_in = stream(COL_TIMESTAMP);
+        decode_timestamps(ts_in, kline.timestamp, nb);
+        if (!ts_in.complete())
+            invalid_file();
+        // the csv parser drops duplicates, so what was compressed is strictly increasing
+        for (size_t ii = 1; ii < nb; ii++)
+        {
+            if (kline.timestamp[ii] <= kline.timestamp[ii - 1])
+                invalid_file();
+        }
+    }
+    if (columns & (KLINE_CLOSE | KLINE_OPEN))
+    {
+        BIT_READER close_in = stream(COL_CLOSE);
+        decode_floats(close_in, kline.close, nullptr, nb);
+        if (!close_in.complete())
+            invalid_file();
+    }
+    for (const KLINE_COLUMN col : {COL_OPEN, COL_HIGH, COL_LOW, COL_VOLUME})
+    {
+        if (columns & (1u << col))
+        {
+            BIT_READER in = stream(col);
+            decode_floats(in, kline_float_column(kline, col), col == COL_OPEN ? &kline.close : nullptr, nb);
+            if (!in.complete())
+                invalid_file();
+        }
+    }
+    if (!(columns & KLINE_CLOSE))
+        std::vector<float>().swap(kline.close);
+    kline.nb = nb;
+
+    munmap(map, st.st_size);
+    return kline;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+// the csv (through its sidecar with use_cache), or the compressed store when the csv is not there
+static KLINEf load_kline(const std::string &input_file_path, const KLINE_COLUMNS columns, const bool use_cache, struct stat &source_st)
+{
+    KLINEf kline;
+    kline.nb = 0;
+
+    if (stat(input_file_path.c_str(), &source_st) != 0)
+    {
+        const std::string compressed_path = kline_compressed_path(input_file_path);
+        if (stat(compressed_path.c_str(), &source_st) == 0)
+            return read_kline_compressed(compressed_path, columns);
+    }
+    else if (use_cache && read_kline_cache(kline_cache_path(input_file_path), source_st, kline, columns))
+        return kline;
+
+    // the sidecar holds every column, whatever this caller asked for
+    kline = parse_kline_csv(input_file_path, use_cache ? KLINE_ALL_COLUMNS : columns, source_st);
+
+    if (use_cache)
+    {
+        write_kline_cache(kline_cache_path(input_file_path), source_st, kline);
+        project_kline_columns(kline, columns);
+    }
+
+    return kline;
+}
+
+KLINEf read_kline_file(const std::string &input_file_path, const KLINE_COLUMNS columns, const bool use_cache)
+{
+    struct stat source_st;
+    return load_kline(input_file_path, columns, use_cache, source_st);
+}
+
+void compress_kline_files(const std::vector<std::string> &input_file_paths)
+{
+    for (const std::string &path : input_file_paths)
+    {
+        struct stat source_st;
+        const KLINEf kline = load_kline(path, KLINE_ALL_COLUMNS, true, source_st);
+        const std::string compressed_path = kline_compressed_path(path);
+        if (!write_kline_compressed(compressed_path, kline))
+        {
+            std::cout << "ERROR: cannot write compressed data file " << compressed_path << std::endl;
+            std::abort();
+        }
+
+        struct stat compressed_st;
+        stat(compressed_path.c_str(), &compressed_st);
+        std::cout << "Compressed " << path << " -> " << compressed_path << " (" << source_st.st_size / 1024 << " KB -> "
+                  << compressed_st.st_size / 1024 << " KB)" << std::endl;
+    }
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+DATA_MODE parse_data_mode(int argc, char **argv)
+{
+    DATA_MODE mode = DATA_READ;
+    for (int i = 1; i < argc; i++)
+    {
+        const std::string arg = argv[i];
+        if (arg == "--compress")
+            mode = DATA_COMPRESS;
+        else
+        {
+            std::cout << "Unknown option " << arg << ". Usage: " << argv[0] << " [--compress]" << std::endl;
+            std::abort();
+        }
+    }
+    return mode;
+}
+
+bool run_data_command(const DATA_MODE mode, const std::vector<std::string> &input_file_paths)
+{
+    if (mode == DATA_COMPRESS)
+        compress_kline_files(input_file_paths);
+    return mode != DATA_READ;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+std::vector<KLINEf> read_kline_files_parallel(const std::vector<std::string> &input_file_paths, const KLINE_COLUMNS columns, uint nb_threads)
+{
+    std::vector<KLINEf> PAIRS(input_file_paths.size());
+
+    if (nb_threads == 0)
+        nb_threads = std::max(1u, std::thread::hardware_concurrency());
+    nb_threads = std::min(nb_threads, uint(input_file_paths.size()));
+
+    // each worker takes the next file index; results land at their own index, so the order never depends on timing
+    std::atomic<uint> next_file{0};
+    auto worker = [&]()
+    {
+        for (uint i = next_file++; i < input_file_paths.size(); i = next_file++)
+        {
+            PAIRS[i] = read_kline_file(input_file_paths[i], columns);
+        }
+    };
+
+    std::vector<std::thread> pool;
+    pool.reserve(nb_threads);
+    for (uint it = 0; it < nb_threads; it++)
+    {
+        pool.emplace_back(worker);
+    }
+    for (std::thread &th : pool)
+    {
+        th.join();
+    }
+
+    for (uint i = 0; i < input_file_paths.size(); i++)
+    {
+        if (PAIRS[i].nb == 0)
+        {
+            std::cout << "ERROR: no data in " << input_file_paths[i] << std::endl;
+            std::abort();
+        }
+        std::cout << "Loaded data file. " << input_file_paths[i] << std::endl;
+    }
+
+    return PAIRS;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void reconcile_last_times(std::vector<KLINEf> &PAIRS, const bool trim)
+{
+    if (PAIRS.empty())
+        return;
+
+    if (trim)
+    {
+        uint common_last = PAIRS[0].timestamp.back();
+        for (const KLINEf &kline : PAIRS)
+        {
+            common_last = std::min(common_last, kline.timestamp.back());
+        }
+
+        for (KLINEf &kline : PAIRS)
+        {
+            if (kline.timestamp.back() == common_last)
+                continue;
+
+            std::cout << "warning: inconsistent last times between different pairs, fixing it." << std::endl;
+            uint nb = kline.nb;
+            while (nb > 0 && kline.timestamp[nb - 1] > common_last)
+            {
+                nb--;
+            }
+            // only the loaded columns are cut (see KLINE_COLUMNS)
+            for (std::vector<float> *column : {&kline.open, &kline.high, &kline.low, &kline.close, &kline.volume})
+            {
+                if (!column->empty())
+                    column->resize(nb);
+            }
+            kline.timestamp.resize(nb);
+            kline.nb = nb;
+        }
+    }
+
+    for (uint ic = 1; ic < PAIRS.size(); ic++)
+    {
+        if (PAIRS[ic].nb == 0 || PAIRS[ic].timestamp.back() != PAIRS[0].timestamp.back())
+        {
+            std::cout << "Error: inconsistent last times between different pairs." << std::endl;
+            std::abort();
+        }
+    }
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+TIME_AXIS align_pairs(std::vector<KLINEf> &PAIRS)
 {
+    TIME_AXIS axis;
+    if (PAIRS.empty())
+        return axis;
+
+    // union of the (sorted) timestamps, one linear merge per pair
+    axis.timestamp = PAIRS[0].timestamp;
+    std::vector<uint> merged;
+    for (uint ic = 1; ic < PAIRS.size(); ic++)
+    {
+        merged.clear();
+        merged.reserve(axis.timestamp.size() + PAIRS[ic].nb);
+        std::set_union(axis.timestamp.begin(), axis.timestamp.end(), PAIRS[ic].timestamp.begin(), PAIRS[ic].timestamp.end(),
+                       std::back_inserter(merged));
+        axis.timestamp.swap(merged);
+    }
+    axis.nb = axis.timestamp.size();
+    axis.first.resize(PAIRS.size());
+    axis.gap_mask.resize(PAIRS.size());
+
+    for (uint ic = 0; ic < PAIRS.size(); ic++)
+    {
+        KLINEf &kline = PAIRS[ic];
+        if (kline.nb == 0 || kline.timestamp.back() != axis.timestamp.back())
+        {
+            std::cout << "Error: inconsistent last times between different pairs." << std::endl;
+            std::abort();
+        }
+
+        const uint first = std::lower_bound(axis.timestamp.begin(), axis.timestamp.end(), kline.timestamp[0]) - axis.timestamp.begin();
+        axis.first[ic] = first;
+        const uint nb = axis.nb - first;
+        if (kline.nb == nb)
+            continue; // the pair has every axis bar since its listing: used as is
+
+        std::vector<uint64_t> &mask = axis.gap_mask[ic];
+        mask.assign((nb + 63) / 64, 0);
+
+        // rebuild the loaded columns on the axis, halted bars repeat the previous close
+        KLINEf filled;
+        filled.timestamp.assign(axis.timestamp.begin() + first, axis.timestamp.end());
+        std::vector<float> *src[] = {&kline.open, &kline.high, &kline.low, &kline.close, &kline.volume};
+        std::vector<float> *dst[] = {&filled.open, &filled.high, &filled.low, &filled.close, &filled.volume};
+        for (uint c = 0; c < 5; c++)
+        {
+            if (!src[c]->empty())
+                dst[c]->resize(nb);
+        }
 
-    if (times.size() <= 4)
+        uint j = 0;
+        for (uint jj = 0; jj < nb; jj++)
+        {
+            if (j < kline.nb && kline.timestamp[j] == filled.timestamp[jj])
+            {
+                for (uint c = 0; c < 5; c++)
+                {
+                    if (!src[c]->empty())
+                        (*dst[c])[jj] = (*src[c])[j];
+                }
+                j++;
+                continue;
+            }
+
+            mask[jj >> 6] |= uint64_t(1) << (jj & 63);
+            const float previous_close = kline.close.empty() ? 0.0f : kline.close[j - 1];
+            for (uint c = 0; c < 5; c++)
+            {
+                if (!src[c]->empty())
+                    (*dst[c])[jj] = (c == 4) ? 0.0f : previous_close;
+            }
+        }
+        filled.nb = nb;
+        filled.indicators = std::move(kline.indicators);
+        kline = std::move(filled);
+
+        std::cout << "warning: " << nb - j << " missing bars filled in pair " << ic << "." << std::endl;
+    }
+
+    return axis;
+}
+
+void PAIR_SIGNALS::pack(const TIME_AXIS &axis, const uint ic, uint8_t *flags, uint64_t *bits) const
+{
+    const uint first = axis.first[ic];
+    const std::vector<uint64_t> &gaps = axis.gap_mask[ic];
+    for (uint w = 0; w < gaps.size(); w++)
+    {
+        for (uint64_t gap = gaps[w]; gap != 0; gap &= gap - 1)
+        {
+            flags[first + w * 64 + __builtin_ctzll(gap)] = 0;
+        }
+    }
+
+    // 8 bytes of 0 / 1 to 8 bits at a time: the multiplication moves byte k to bit 56 + k
+    for (uint w = 0; w < nb_words; w++)
+    {
+        uint64_t word = 0;
+        for (uint k = 0; k < 8; k++)
+        {
+            uint64_t eight;
+            memcpy(&eight, flags + w * 64 + k * 8, 8);
+            word |= ((eight * 0x0102040810204080ULL) >> 56) << (k * 8);
+        }
+        bits[w] = word;
+    }
+}
+
+uint PAIR_SIGNALS::next_event(const uint ii, const float *coin_amounts, const bool can_open) const
+{
+    if (ii >= nb)
+        return nb;
+    const uint nb_pairs = open_bits.size() / nb_words;
+    for (uint w = ii >> 6; w < nb_words; w++)
+    {
+        uint64_t events = 0;
+        for (uint ic = 0; ic < nb_pairs; ic++)
+        {
+            if (coin_amounts[ic] > 0.0f)
+                events |= close_bits[ic * nb_words + w];
+            else if (can_open)
+                events |= open_bits[ic * nb_words + w];
+        }
+        if (w == ii >> 6)
+            events &= ~uint64_t(0) << (ii & 63);
+        if (events != 0)
+            return std::min(w * 64 + __builtin_ctzll(events), nb - 1);
+    }
+    return nb - 1;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+PANEL make_panel(const TIME_AXIS &axis, const std::vector<const float *> &columns)
+{
+    if (columns.size() != axis.first.size())
+    {
+        std::cout << "Error: panel needs one column per pair of the time axis." << std::endl;
+        std::abort();
+    }
+
+    const uint nb_pairs = columns.size();
+    PANEL panel;
+    panel.nb = axis.nb;
+    panel.stride = (nb_pairs + 15) / 16 * 16;
+    panel.data.assign(size_t(panel.nb) * panel.stride, 0.0f);
+
+    for (uint ic = 0; ic < nb_pairs; ic++)
+    {
+        const float *column = columns[ic];
+        const uint first = axis.first[ic];
+        float *out = panel.data.data() + size_t(first) * panel.stride + ic;
+        for (uint jj = 0; jj < axis.nb - first; jj++)
+        {
+            out[size_t(jj) * panel.stride] = column[jj];
+        }
+    }
+
+    return panel;
+}
+
+PANEL make_panel(const TIME_AXIS &axis, const std::vector<const std::vector<float> *> &columns)
+{
+    std::vector<const float *> spans;
+    for (uint ic = 0; ic < columns.size(); ic++)
+    {
+        if (ic < axis.first.size() && columns[ic]->size() != axis.nb - axis.first[ic])
+        {
+            std::cout << "Error: panel column " << ic << " does not cover the bars of its pair." << std::endl;
+            std::abort();
+        }
+        spans.push_back(columns[ic]->data());
+    }
+    return make_panel(axis, spans);
+}
+
+PANEL make_panel(const TIME_AXIS &axis, const std::vector<KLINEf> &PAIRS, std::vector<float> KLINEf::*column)
+{
+    std::vector<const std::vector<float> *> columns;
+    for (const KLINEf &kline : PAIRS)
+    {
+        columns.push_back(&(kline.*column));
+    }
+    return make_panel(axis, columns);
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+float calculate_calmar_ratio(const CALENDAR_INDEX &calendar, const std::vector<uint> &bars, const std::vector<float> &wallet_vals, const float &max_DD)
+{
+
+    if (bars.size() <= 4)
         return -100.0;
 
-    const uint last_idx = times.size() - 1;
-    const int first_year = get_year_from_timestamp(times[0]);
-    const int first_month = get_month_from_timestamp(times[0]);
-    const int first_day = get_day_from_timestamp(times[0]);
-    const int last_year = get_year_from_timestamp(times[last_idx]);
-    const int last_month = get_month_from_timestamp(times[last_idx]);
-    const int last_day = get_day_from_timestamp(times[last_idx]);
+    const uint first = bars[0];
+    const uint last = bars[bars.size() - 1];
 
-    const float factor_first_year = (365.0f - float(first_month) * 30.0f - float(first_day)) / 365.0f;
-    const float factor_last_year = (float(last_month) * 30.0f + float(last_day)) / 365.0f;
+    const float factor_first_year = (365.0f - float(calendar.month(first)) * 30.0f - float(calendar.day[first])) / 365.0f;
+    const float factor_last_year = (float(calendar.month(last)) * 30.0f + float(calendar.day[last])) / 365.0f;
 
     std::vector<float> vals_begin_years{};
     vals_begin_years.reserve(10);
 
     vals_begin_years.push_back(1000.0);
 
-    for (uint ii = 1; ii < times.size(); ii++)
+    for (uint ii = 1; ii < bars.size(); ii++)
     {
-        const int year_b = get_year_from_timestamp(times[ii - 1]);
-        const int year = get_year_from_timestamp(times[ii]);
-
-        if (year_b != year || ii == times.size() - 1)
+        if (calendar.year(bars[ii - 1]) != calendar.year(bars[ii]) || ii == bars.size() - 1)
         {
             vals_begin_years.push_back(wallet_vals[ii]);
         }
@@ -433,34 +1524,26 @@ float calculate_calmar_ratio(const std::vector<int> &times, const std::vector<fl
 
 //////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
-float calculate_calmar_ratio_monthly(const std::vector<int> &times, const std::vector<float> &wallet_vals, const float &max_DD)
+float calculate_calmar_ratio_monthly(const CALENDAR_INDEX &calendar, const std::vector<uint> &bars, const std::vector<float> &wallet_vals, const float &max_DD)
 {
 
-    if (times.size() <= 4)
+    if (bars.size() <= 4)
         return -100.0;
 
-    const uint last_idx = times.size() - 1;
-    const int first_year = get_year_from_timestamp(times[0]);
-    const int first_month = get_month_from_timestamp(times[0]);
-    const int first_day = get_day_from_timestamp(times[0]);
-    const int last_year = get_year_from_timestamp(times[last_idx]);
-    const int last_month = get_month_from_timestamp(times[last_idx]);
-    const int last_day = get_day_from_timestamp(times[last_idx]);
+    const uint first = bars[0];
+    const uint last = bars[bars.size() - 1];
 
-    const float factor_first_month = (12.0f - float(first_day) / 30.0f) / 12.0f;
-    const float factor_last_month = (float(last_day) / 30.0f) / 12.0f;
+    const float factor_first_month = (12.0f - float(calendar.day[first]) / 30.0f) / 12.0f;
+    const float factor_last_month = (float(calendar.day[last]) / 30.0f) / 12.0f;
 
     std::vector<float> vals_begin_months{};
     vals_begin_months.reserve(50);
 
     vals_begin_months.push_back(1000.0);
 
-    for (uint ii = 1; ii < times.size(); ii++)
+    for (uint ii = 1; ii < bars.size(); ii++)
     {
-        const int month_b = get_month_from_timestamp(times[ii - 1]);
-        const int month = get_month_from_timestamp(times[ii]);
-
-        if (month_b != month || ii == times.size() - 1)
+        if (calendar.month_id[bars[ii - 1]] != calendar.month_id[bars[ii]] || ii == bars.size() - 1)
         {
             vals_begin_months.push_back(wallet_vals[ii]);
         }
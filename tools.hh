@@ -1,3 +1,4 @@
+#pragma once
 #include <stdio.h>
 #include <vector>
 #include <array>
@@ -9,6 +10,8 @@
 #include <fstream>
 #include <algorithm> // std::shuffle
 #include <random>    // std::default_random_engine
+#include <string>
+#include "custom_talib_wrapper.hh"
 
 //////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
@@ -27,6 +30,10 @@ struct RUN_RESULTf
     int ema4;
     int trixLength;
     int trixSignal;
+    int stoch_window;
+    int willr_length;
+    int atr_window;
+    float atr_multi;
     float UP;
     float DOWN;
     float min_yearly_gain;
@@ -51,6 +58,7 @@ struct trix_params
     int ema1;
     int trixLength;
     int trixSignal;
+    int stoch_window;
     uint max_open_trades;
 };
 
@@ -60,6 +68,8 @@ struct BigWill_params
     int AO_slow;
     int ema_f;
     int ema_s;
+    int stoch_window;
+    int willr_length;
     uint max_open_trades;
 };
 
@@ -78,6 +88,8 @@ struct SR_params
 {
     int ema_fast;
     int ema_slow;
+    int atr_window;
+    float atr_multi;
     uint max_open_trades;
 };
 
@@ -108,6 +120,38 @@ float find_max(const std::vector<float> &vec);
 int find_max(const std::vector<int> &vec);
 //////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
+// UTC calendar fields of a unix timestamp (seconds), computed arithmetically: no localtime, no allocation
+struct CIVIL_TIME
+{
+    int year;
+    int month; // 1-12
+    int day;   // 1-31
+    int hour;  // 0-23
+};
+CIVIL_TIME civil_from_timestamp(const int timestamp);
+
+// per-bar calendar flags, relative to the previous bar (bar 0 has them all)
+enum CALENDAR_FLAG : uint8_t
+{
+    CAL_NEW_DAY = 1 << 0,
+    CAL_NEW_MONTH = 1 << 1,
+    CAL_NEW_YEAR = 1 << 2,
+    CAL_FUNDING = 1 << 3 // a futures funding event (00:00, 08:00 or 16:00 UTC) happened since the previous bar
+};
+
+// calendar of a dataset, built once after loading and shared by all the backtest runs, so that the
+// per-bar loops and the calmar calculators read flags instead of decoding timestamps
+struct CALENDAR_INDEX
+{
+    std::vector<uint8_t> flags;     // CALENDAR_FLAG bits, per bar
+    std::vector<uint16_t> month_id; // months since January 1970, per bar
+    std::vector<uint8_t> day;       // day of the month, per bar
+
+    int year(const uint ii) const { return 1970 + month_id[ii] / 12; }
+    int month(const uint ii) const { return month_id[ii] % 12 + 1; }
+};
+CALENDAR_INDEX build_calendar_index(const std::vector<uint> &timestamp);
+
 int get_hour_from_timestamp(const int timestamp);
 
 int get_year_from_timestamp(const int timestamp);
@@ -139,8 +183,188 @@ std::string ReplaceAll(std::string str, const std::string &from, const std::stri
 
 //////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
-float calculate_calmar_ratio(const std::vector<int> &times, const std::vector<float> &wallet_vals, const float &max_DD);
-float calculate_calmar_ratio_monthly(const std::vector<int> &times, const std::vector<float> &wallet_vals, const float &max_DD);
+// columns of a data file, in file order
+enum KLINE_COLUMN
+{
+    COL_TIMESTAMP,
+    COL_OPEN,
+    COL_HIGH,
+    COL_LOW,
+    COL_CLOSE,
+    COL_VOLUME,
+    NB_KLINE_COLUMNS
+};
+
+// column mask for the loaders: the KLINEf columns left out are neither parsed nor allocated (they stay empty, nb is
+// still the number of bars). Most strategies only read timestamp and close.
+enum KLINE_COLUMNS : uint
+{
+    KLINE_TIMESTAMP = 1u << COL_TIMESTAMP,
+    KLINE_OPEN = 1u << COL_OPEN,
+    KLINE_HIGH = 1u << COL_HIGH,
+    KLINE_LOW = 1u << COL_LOW,
+    KLINE_CLOSE = 1u << COL_CLOSE,
+    KLINE_VOLUME = 1u << COL_VOLUME,
+    KLINE_OHLC = KLINE_TIMESTAMP | KLINE_OPEN | KLINE_HIGH | KLINE_LOW | KLINE_CLOSE,
+    KLINE_ALL_COLUMNS = KLINE_OHLC | KLINE_VOLUME
+};
+inline KLINE_COLUMNS operator|(const KLINE_COLUMNS a, const KLINE_COLUMNS b) { return KLINE_COLUMNS(uint(a) | uint(b)); }
+
+// reads a "unix-timestamp(ms);open;high;low;close;volume" file through mmap, straight into the KLINEf columns
+// (timestamps are converted to seconds, rows repeating the previous timestamp are ignored)
+// With use_cache, the parsed columns are saved to a binary sidecar (kline_cache_path) the first time, and later runs
+// map that file instead of parsing the csv again. The sidecar is rebuilt whenever the csv size or mtime changes.
+// It always holds every column, so that strategies with different masks share it.
+KLINEf read_kline_file(const std::string &input_file_path, const KLINE_COLUMNS columns = KLINE_OHLC, const bool use_cache = true);
+std::string kline_cache_path(const std::string &input_file_path);
+
+// compressed store "<pair>.klz" next to "<pair>.csv": delta-of-delta timestamps and Gorilla XOR floats, about 3 times
+// smaller than the csv. read_kline_file() decodes it when the csv is absent, so the history can be kept compressed only.
+std::string kline_compressed_path(const std::string &input_file_path);
+void compress_kline_files(const std::vector<std::string> &input_file_paths);
+KLINEf read_kline_compressed(const std::string &compressed_path, const KLINE_COLUMNS columns = KLINE_OHLC);
+
+// data source selected on the command line of the strategies:
+//   (none)       read the csv files (or their binary sidecars)
+//   --compress   write the compressed store of each file (see kline_compressed_path) and exit
+enum DATA_MODE
+{
+    DATA_READ,
+    DATA_COMPRESS
+};
+DATA_MODE parse_data_mode(int argc, char **argv);
+// does the compress work; returns true when the program should stop there
+bool run_data_command(const DATA_MODE mode, const std::vector<std::string> &input_file_paths);
+
+// loads all files concurrently (nb_threads = 0 uses every core); PAIRS[i] is always the data of input_file_paths[i]
+std::vector<KLINEf> read_kline_files_parallel(const std::vector<std::string> &input_file_paths, const KLINE_COLUMNS columns = KLINE_OHLC,
+                                              uint nb_threads = 0);
+
+// makes all pairs end on the same timestamp, in a single pass after loading.
+// trim = true drops the extra last bars of the pairs ending later than the others, trim = false aborts on any mismatch
+void reconcile_last_times(std::vector<KLINEf> &PAIRS, const bool trim);
+
+// one time axis shared by a set of pairs (the union of their timestamps). Pairs are not padded:
+// bar ii of the axis is bar ii - first[ic] of pair ic, for ii >= first[ic].
+// Bars that the axis has and a pair lacks after its listing (trading halts) are filled with the
+// previous close of that pair, and flagged in its gap mask so that strategies do not trade on them.
+struct TIME_AXIS
+{
+    std::vector<uint> timestamp;
+    uint nb;
+    std::vector<uint> first;                    // axis index of the first bar, per pair
+    std::vector<std::vector<uint64_t>> gap_mask; // one bit per axis bar from first, per pair; empty when the pair has no gap
+
+    bool listed(const uint ic, const uint ii) const { return ii >= first[ic]; }
+    uint local(const uint ic, const uint ii) const { return ii - first[ic]; }
+    bool is_gap(const uint ic, const uint ii) const
+    {
+        if (gap_mask[ic].empty())
+            return false;
+        const uint jj = ii - first[ic];
+        return (gap_mask[ic][jj >> 6] >> (jj & 63)) & 1;
+    }
+};
+
+// builds the axis in a linear merge of the timestamps; only the pairs with gaps are rewritten.
+// Pairs must end on the same timestamp (see reconcile_last_times)
+TIME_AXIS align_pairs(std::vector<KLINEf> &PAIRS);
+
+// Open / close signals of every pair as one bit per axis bar, for the parts of the strategy conditions that depend only
+// on prices and indicators. The bits are 0 before the start bar of a pair and on its gaps, so a multi-pair loop only has
+// to visit the bars given by next_event(): on the others no position can open or close
+struct PAIR_SIGNALS
+{
+    uint nb;       // bars of the axis
+    uint nb_words; // 64-bar words per pair
+    std::vector<uint64_t> open_bits;  // pair ic from ic * nb_words
+    std::vector<uint64_t> close_bits; // same
+
+    PAIR_SIGNALS(const uint nb_pairs, const uint nb)
+        : nb(nb), nb_words((nb + 63) / 64), open_bits(size_t(nb_pairs) * nb_words), close_bits(size_t(nb_pairs) * nb_words) {}
+
+    bool open(const uint ic, const uint ii) const { return (open_bits[ic * nb_words + (ii >> 6)] >> (ii & 63)) & 1; }
+    bool close(const uint ic, const uint ii) const { return (close_bits[ic * nb_words + (ii >> 6)] >> (ii & 63)) & 1; }
+
+    // bits of pair ic from open_condi(jj) / close_condi(jj) on the local bars jj of the pair, from the axis bar start.
+    // The conditions are evaluated into bytes over the whole series, a loop the compiler vectorises when they are
+    // written with & instead of &&, then packed
+    template <typename OPEN_CONDITION, typename CLOSE_CONDITION>
+    void set_pair(const TIME_AXIS &axis, const uint ic, const uint start, OPEN_CONDITION open_condi, CLOSE_CONDITION close_condi)
+    {
+        thread_local std::vector<uint8_t> flags;
+        flags.assign(size_t(nb_words) * 64, 0);
+        const uint first = axis.first[ic];
+        uint8_t *local = flags.data() + first;
+        const uint jj_end = nb - first;
+
+        for (uint jj = start - first; jj < jj_end; jj++)
+            local[jj] = open_condi(jj);
+        pack(axis, ic, flags.data(), open_bits.data() + size_t(ic) * nb_words);
+        for (uint jj = start - first; jj < jj_end; jj++)
+            local[jj] = close_condi(jj);
+        pack(axis, ic, flags.data(), close_bits.data() + size_t(ic) * nb_words);
+    }
+
+    // first bar from ii where a pair in position (coin_amounts[ic] > 0) has a close signal, or, when can_open, a pair out
+    // of position an open signal. The last bar, where every position is closed, is always an event; nb past it
+    uint next_event(const uint ii, const float *coin_amounts, const bool can_open) const;
+
+private:
+    // clears the gaps of pair ic in the axis flags (0 / 1 bytes) and packs them into bits
+    void pack(const TIME_AXIS &axis, const uint ic, uint8_t *flags, uint64_t *bits) const;
+};
+
+// std::vector allocator returning 64-byte (cache line) aligned blocks
+template <typename T>
+struct CACHE_LINE_ALLOCATOR
+{
+    using value_type = T;
+    CACHE_LINE_ALLOCATOR() = default;
+    template <typename U>
+    CACHE_LINE_ALLOCATOR(const CACHE_LINE_ALLOCATOR<U> &) {}
+    T *allocate(const size_t n) { return static_cast<T *>(::operator new(n * sizeof(T), std::align_val_t(64))); }
+    void deallocate(T *p, const size_t) { ::operator delete(p, std::align_val_t(64)); }
+    template <typename U>
+    bool operator==(const CACHE_LINE_ALLOCATOR<U> &) const { return true; }
+    template <typename U>
+    bool operator!=(const CACHE_LINE_ALLOCATOR<U> &) const { return false; }
+};
+
+// read-only view of a PANEL, cheap to copy into the per-bar loops
+struct PANEL_VIEW
+{
+    const float *data;
+    uint stride; // floats between two bars
+    uint nb;     // bars
+
+    const float *bar(const uint ii) const { return data + size_t(ii) * stride; }
+    float operator()(const uint ii, const uint ic) const { return data[size_t(ii) * stride + ic]; }
+};
+
+// bar-major [bar][pair] copy of one column of all the pairs of a TIME_AXIS. The cross-section of a bar is
+// contiguous and starts on a cache line (stride rounded up to 16 floats), so a loop over the pairs of one bar
+// reads one or two cache lines per column instead of one per pair. Bars before a pair's listing hold 0
+struct PANEL
+{
+    std::vector<float, CACHE_LINE_ALLOCATOR<float>> data;
+    uint stride;
+    uint nb;
+
+    PANEL_VIEW view() const { return {data.data(), stride, nb}; }
+};
+
+// columns[ic] is indexed by the bars of pair ic (PAIRS[ic].close, an indicator computed on PAIRS[ic], ...)
+PANEL make_panel(const TIME_AXIS &axis, const std::vector<const std::vector<float> *> &columns);
+// same from spans, columns[ic] holding the axis.nb - axis.first[ic] bars of pair ic
+PANEL make_panel(const TIME_AXIS &axis, const std::vector<const float *> &columns);
+PANEL make_panel(const TIME_AXIS &axis, const std::vector<KLINEf> &PAIRS, std::vector<float> KLINEf::*column);
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+// wallet_vals[k] is the wallet value at bar bars[k] of the dataset described by calendar
+float calculate_calmar_ratio(const CALENDAR_INDEX &calendar, const std::vector<uint> &bars, const std::vector<float> &wallet_vals, const float &max_DD);
+float calculate_calmar_ratio_monthly(const CALENDAR_INDEX &calendar, const std::vector<uint> &bars, const std::vector<float> &wallet_vals, const float &max_DD);
 
 //////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 